@@ -24,6 +24,7 @@
 
 #include <config.h>
 
+#include <string.h>
 #include <glib/gi18n-lib.h>
 #include "application.h"
 #include "private.h"
@@ -111,6 +112,37 @@ _wnck_application_shutdown_all (void)
     }
 }
 
+void
+_wnck_application_add_memory_usage (WnckMemoryUsage *usage,
+                                    GHashTable      *pixbufs)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  if (app_hash == NULL)
+    return;
+
+  g_hash_table_iter_init (&iter, app_hash);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      WnckApplication *app = value;
+
+      usage->n_applications++;
+      usage->application_bytes += sizeof (WnckApplication) +
+                                  sizeof (WnckApplicationPrivate);
+      if (app->priv->name)
+        usage->application_bytes += strlen (app->priv->name) + 1;
+      if (app->priv->startup_id)
+        usage->application_bytes += strlen (app->priv->startup_id) + 1;
+
+      if (app->priv->icon_cache)
+        usage->n_icon_caches++;
+
+      _wnck_memory_usage_add_pixbuf (usage, pixbufs, app->priv->icon);
+      _wnck_memory_usage_add_pixbuf (usage, pixbufs, app->priv->mini_icon);
+    }
+}
+
 static void
 wnck_application_init (WnckApplication *application)
 {
@@ -52,7 +52,7 @@
 
 /* Private part of the WnckClassGroup structure */
 struct _WnckClassGroupPrivate {
-  char *res_class;
+  const char *res_class; /* interned */
   char *name;
   GList *windows;
 
@@ -63,7 +63,9 @@ struct _WnckClassGroupPrivate {
 G_DEFINE_TYPE (WnckClassGroup, wnck_class_group, G_TYPE_OBJECT);
 #define WNCK_CLASS_GROUP_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), WNCK_TYPE_CLASS_GROUP, WnckClassGroupPrivate))
 
-/* Hash table that maps res_class strings -> WnckClassGroup instances */
+/* Hash table that maps interned res_class strings -> WnckClassGroup
+ * instances; keys are compared by pointer
+ */
 static GHashTable *class_group_hash = NULL;
 
 
@@ -90,6 +92,32 @@ _wnck_class_group_shutdown_all (void)
     }
 }
 
+void
+_wnck_class_group_add_memory_usage (WnckMemoryUsage *usage,
+                                    GHashTable      *pixbufs)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  if (class_group_hash == NULL)
+    return;
+
+  g_hash_table_iter_init (&iter, class_group_hash);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      WnckClassGroup *class_group = value;
+
+      usage->n_class_groups++;
+      usage->class_group_bytes += sizeof (WnckClassGroup) +
+                                  sizeof (WnckClassGroupPrivate);
+      if (class_group->priv->name)
+        usage->class_group_bytes += strlen (class_group->priv->name) + 1;
+
+      _wnck_memory_usage_add_pixbuf (usage, pixbufs, class_group->priv->icon);
+      _wnck_memory_usage_add_pixbuf (usage, pixbufs, class_group->priv->mini_icon);
+    }
+}
+
 static void
 wnck_class_group_class_init (WnckClassGroupClass *class)
 {
@@ -149,8 +177,7 @@ wnck_class_group_finalize (GObject *object)
 
   class_group = WNCK_CLASS_GROUP (object);
 
-  if (class_group->priv->res_class)
-    g_free (class_group->priv->res_class);
+  _wnck_intern_release (class_group->priv->res_class);
   class_group->priv->res_class = NULL;
 
   if (class_group->priv->name)
@@ -187,10 +214,17 @@ wnck_class_group_finalize (GObject *object)
 WnckClassGroup *
 wnck_class_group_get (const char *id)
 {
+  const char *interned;
+
   if (!class_group_hash)
     return NULL;
-  else
-    return g_hash_table_lookup (class_group_hash, id ? id : "");
+
+  /* a string that is not in the pool cannot be the id of any group */
+  interned = _wnck_intern_lookup (id ? id : "");
+  if (interned == NULL)
+    return NULL;
+
+  return g_hash_table_lookup (class_group_hash, interned);
 }
 
 /**
@@ -210,18 +244,17 @@ _wnck_class_group_create (const char *res_class)
   WnckClassGroup *class_group;
 
   if (class_group_hash == NULL)
-    class_group_hash = g_hash_table_new_full (g_str_hash, g_str_equal,
+    class_group_hash = g_hash_table_new_full (NULL, NULL,
                                               NULL, g_object_unref);
 
-  g_return_val_if_fail (g_hash_table_lookup (class_group_hash, res_class ? res_class : "") == NULL,
-			NULL);
+  g_return_val_if_fail (wnck_class_group_get (res_class) == NULL, NULL);
 
   class_group = g_object_new (WNCK_TYPE_CLASS_GROUP, NULL);
 
-  class_group->priv->res_class = g_strdup (res_class ? res_class : "");
+  class_group->priv->res_class = _wnck_intern_string (res_class ? res_class : "");
 
   g_hash_table_insert (class_group_hash,
-                       class_group->priv->res_class, class_group);
+                       (gpointer) class_group->priv->res_class, class_group);
   /* Hash now owns one ref, caller gets none */
 
   return class_group;
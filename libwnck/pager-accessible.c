@@ -33,7 +33,9 @@
 typedef struct _WnckPagerAccessiblePriv WnckPagerAccessiblePriv;
 struct _WnckPagerAccessiblePriv
 {
-  GSList *children;
+  /* WnckWorkspaceAccessible of each workspace, indexed by workspace
+   * number; elements are created lazily and can be NULL */
+  GPtrArray *children;
 };
 
 static void        wnck_pager_accessible_class_init       (WnckPagerAccessibleClass *klass);
@@ -53,6 +55,8 @@ static int         wnck_pager_selection_count             (AtkSelection
 static void        wnck_pager_accessible_update_workspace (AtkObject                *aobj_ws,
                                                            WnckPager                *pager,
                                                            int                       i);
+static void        wnck_pager_accessible_set_n_children   (AtkObject                *obj,
+                                                           int                       n_children);
 static void        wnck_pager_accessible_finalize         (GObject                  *gobject);
 
 static WnckPagerAccessiblePriv* get_private_data          (GObject                  *gobject);
@@ -309,20 +313,16 @@ static void
 wnck_pager_accessible_finalize (GObject *gobject)
 {
   WnckPagerAccessiblePriv *pager_accessible_priv;
-  GSList *children;
+  guint i;
 
   pager_accessible_priv = get_private_data (gobject);
 
   if (pager_accessible_priv)
     {
-      if (pager_accessible_priv->children)
-        {
-          children = pager_accessible_priv->children;
-          g_slist_foreach (children,
-                           (GFunc) g_object_unref, NULL);
-
-          g_slist_free (children);
-        }
+      for (i = 0; i < pager_accessible_priv->children->len; i++)
+        if (g_ptr_array_index (pager_accessible_priv->children, i) != NULL)
+          g_object_unref (g_ptr_array_index (pager_accessible_priv->children, i));
+      g_ptr_array_free (pager_accessible_priv->children, TRUE);
 
       g_free (pager_accessible_priv);
       g_object_set_qdata (gobject,
@@ -394,7 +394,6 @@ wnck_pager_accessible_ref_child (AtkObject *obj,
   GtkWidget *widget;
   WnckPager *pager;
   int n_spaces = 0;
-  int len;
   WnckPagerAccessiblePriv *pager_accessible_priv;
   AtkObject *ret;
 
@@ -415,44 +414,100 @@ wnck_pager_accessible_ref_child (AtkObject *obj,
   pager = WNCK_PAGER (widget);
   pager_accessible_priv = get_private_data (G_OBJECT (obj));
 
-  len = g_slist_length (pager_accessible_priv->children);
   n_spaces = _wnck_pager_get_n_workspaces (pager);
 
   if (i < 0 || i >= n_spaces)
     return NULL;
 
-  /* We are really inefficient about this due to all the appending,
-   * and never shrink the list either.
-   */
-  while (n_spaces > len)
+  /* the pager normally keeps us in sync, but be safe if it could not */
+  if (pager_accessible_priv->children->len != (guint) n_spaces)
+    wnck_pager_accessible_set_n_children (obj, n_spaces);
+
+  ret = g_ptr_array_index (pager_accessible_priv->children, i);
+
+  if (ret == NULL)
     {
       AtkRegistry *default_registry;
       AtkObjectFactory *factory;
       WnckWorkspace *wspace;
-      WnckWorkspaceAccessible *space_accessible;
 
       default_registry = atk_get_default_registry ();
       factory = atk_registry_get_factory (default_registry,
                                           WNCK_TYPE_WORKSPACE);
 
-      wspace = _wnck_pager_get_workspace (pager, len);
-      space_accessible = WNCK_WORKSPACE_ACCESSIBLE (atk_object_factory_create_accessible (factory,
-                                                                                          G_OBJECT (wspace)));
-      atk_object_set_parent (ATK_OBJECT (space_accessible), obj);
-
-      pager_accessible_priv->children = g_slist_append (pager_accessible_priv->children,
-                                                   space_accessible);
+      wspace = _wnck_pager_get_workspace (pager, i);
+      ret = atk_object_factory_create_accessible (factory, G_OBJECT (wspace));
+      atk_object_set_parent (ret, obj);
 
-      ++len;
+      g_ptr_array_index (pager_accessible_priv->children, i) = ret;
     }
 
-  ret = g_slist_nth_data (pager_accessible_priv->children, i);
   g_object_ref (G_OBJECT (ret));
   wnck_pager_accessible_update_workspace (ret, pager, i);
 
   return ret;
 }
 
+/*
+ * Releases the accessibles of the workspaces that do not exist anymore, and
+ * makes room for the new ones (created in ref_child)
+ */
+static void
+wnck_pager_accessible_set_n_children (AtkObject *obj,
+                                      int        n_children)
+{
+  WnckPagerAccessiblePriv *pager_accessible_priv;
+  GPtrArray *children;
+  int len;
+  int i;
+
+  pager_accessible_priv = get_private_data (G_OBJECT (obj));
+  children = pager_accessible_priv->children;
+  len = children->len;
+
+  for (i = len - 1; i >= n_children; i--)
+    {
+      AtkObject *child;
+
+      child = g_ptr_array_index (children, i);
+      g_ptr_array_set_size (children, i);
+
+      g_signal_emit_by_name (obj, "children_changed::remove", i, child);
+
+      if (child)
+        g_object_unref (child);
+    }
+
+  if (n_children > len)
+    {
+      g_ptr_array_set_size (children, n_children);
+
+      for (i = len; i < n_children; i++)
+        g_signal_emit_by_name (obj, "children_changed::add", i, NULL);
+    }
+}
+
+void
+_wnck_pager_accessible_workspaces_changed (AtkObject *obj)
+{
+  GtkWidget *widget;
+
+  g_return_if_fail (WNCK_PAGER_IS_ACCESSIBLE (obj));
+
+#if GTK_CHECK_VERSION(2,21,0)
+  widget = gtk_accessible_get_widget (GTK_ACCESSIBLE (obj));
+#else
+  widget = GTK_ACCESSIBLE (obj)->widget;
+#endif
+
+  if (widget == NULL)
+    /* State is defunct */
+    return;
+
+  wnck_pager_accessible_set_n_children (obj,
+                                        _wnck_pager_get_n_workspaces (WNCK_PAGER (widget)));
+}
+
 static void
 wnck_pager_accessible_update_workspace (AtkObject *aobj_ws,
                                         WnckPager *pager,
@@ -477,6 +532,7 @@ get_private_data (GObject *gobject)
   if (!private_data)
     {
       private_data = g_new0 (WnckPagerAccessiblePriv, 1);
+      private_data->children = g_ptr_array_new ();
       g_object_set_qdata (gobject,
                           quark_private_data,
                           private_data);
@@ -52,6 +52,8 @@ GType wnck_pager_accessible_get_type (void) G_GNUC_CONST;
 
 AtkObject* wnck_pager_accessible_new (GtkWidget *widget); 
 
+void _wnck_pager_accessible_workspaces_changed (AtkObject *obj);
+
 G_END_DECLS
 
 #endif /* __WNCK_PAGER_ACCESSIBLE_H__ */
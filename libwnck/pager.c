@@ -27,12 +27,14 @@
 #include <config.h>
 
 #include <math.h>
+#include <string.h>
 #include <glib/gi18n-lib.h>
 
 #include "pager.h"
 #include "workspace.h"
 #include "window.h"
 #include "xutils.h"
+#include "pager-accessible.h"
 #include "pager-accessible-factory.h"
 #include "workspace-accessible-factory.h"
 #include "private.h"
@@ -61,6 +63,26 @@
 
 #define N_SCREEN_CONNECTIONS 11
 
+/* Colors used to draw a workspace in a given state. They are looked up in
+ * the style context only once per style change, instead of once per
+ * window on each draw.
+ */
+typedef struct
+{
+  GdkRGBA bg;        /* background of windows */
+  GdkRGBA active_bg; /* background of the active window, bg shaded by 1.3 */
+  GdkRGBA fg;        /* frame of windows and workspace names */
+  GdkRGBA dark;      /* background of workspaces, bg shaded by 0.7 */
+} WnckPagerStateColors;
+
+enum
+{
+  PAGER_STATE_NORMAL,
+  PAGER_STATE_SELECTED,
+  PAGER_STATE_PRELIGHT,
+  N_PAGER_STATES
+};
+
 struct _WnckPagerPrivate
 {
   WnckScreen *screen;
@@ -81,10 +103,26 @@ struct _WnckPagerPrivate
   int drag_start_y;
   WnckWindow *drag_window;
 
+  /* Thumbnail of the background: it is computed asynchronously for the
+   * size bg_width x bg_height, see wnck_pager_get_background() */
   GdkPixbuf *bg_cache;
+  int bg_width;
+  int bg_height;
+  guint bg_generation;
+  guint bg_fetch_idle;
+
+  /* PangoLayout of the name of each workspace, used in the name display
+   * mode; elements are created lazily and can be NULL */
+  GPtrArray *name_layouts;
+
+  WnckPagerStateColors state_colors[N_PAGER_STATES];
+  guint state_colors_valid : 1;
 
   int layout_manager_token;
 
+  /* our WnckPagerAccessible, if it was created; weak pointer */
+  AtkObject *accessible;
+
   guint dnd_activate; /* GSource that triggers switching to this workspace during dnd */
   guint dnd_time; /* time of last event during dnd (for delayed workspace activation) */
 };
@@ -92,6 +130,9 @@ struct _WnckPagerPrivate
 G_DEFINE_TYPE (WnckPager, wnck_pager, GTK_TYPE_WIDGET);
 #define WNCK_PAGER_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), WNCK_TYPE_PAGER, WnckPagerPrivate))
 
+/* only used by wnck_read_memory_usage() */
+static GSList *pager_instances = NULL;
+
 enum
 {
   dummy, /* remove this when you add more signals */
@@ -111,6 +152,9 @@ static void wnck_pager_finalize    (GObject        *object);
 
 static void     wnck_pager_realize       (GtkWidget        *widget);
 static void     wnck_pager_unrealize     (GtkWidget        *widget);
+static void     wnck_pager_style_updated (GtkWidget        *widget);
+static void     wnck_pager_direction_changed (GtkWidget        *widget,
+                                              GtkTextDirection  previous_direction);
 static GtkSizeRequestMode wnck_pager_get_request_mode (GtkWidget *widget);
 static void     wnck_pager_get_preferred_width (GtkWidget *widget,
                                                 int       *minimum_width,
@@ -201,6 +245,11 @@ static void wnck_pager_check_prelight (WnckPager *pager,
 static GdkPixbuf* wnck_pager_get_background (WnckPager *pager,
                                              int        width,
                                              int        height);
+static void wnck_pager_invalidate_background (WnckPager *pager);
+
+static PangoLayout* wnck_pager_get_name_layout    (WnckPager *pager,
+                                                   int        workspace);
+static void         wnck_pager_clear_name_layouts (WnckPager *pager);
 
 static AtkObject* wnck_pager_get_accessible (GtkWidget *widget);
 
@@ -235,9 +284,21 @@ wnck_pager_init (WnckPager *pager)
   pager->priv->drag_window = NULL;
 
   pager->priv->bg_cache = NULL;
+  pager->priv->bg_width = -1;
+  pager->priv->bg_height = -1;
+  pager->priv->bg_generation = 0;
+  pager->priv->bg_fetch_idle = 0;
+
+  pager->priv->name_layouts = g_ptr_array_new ();
+
+  pager_instances = g_slist_prepend (pager_instances, pager);
+
+  pager->priv->state_colors_valid = FALSE;
 
   pager->priv->layout_manager_token = WNCK_NO_MANAGER_TOKEN;
 
+  pager->priv->accessible = NULL;
+
   pager->priv->dnd_activate = 0;
   pager->priv->dnd_time = 0;
 
@@ -259,6 +320,8 @@ wnck_pager_class_init (WnckPagerClass *klass)
 
   widget_class->realize = wnck_pager_realize;
   widget_class->unrealize = wnck_pager_unrealize;
+  widget_class->style_updated = wnck_pager_style_updated;
+  widget_class->direction_changed = wnck_pager_direction_changed;
   widget_class->get_request_mode = wnck_pager_get_request_mode;
   widget_class->get_preferred_width = wnck_pager_get_preferred_width;
   widget_class->get_preferred_width_for_height = wnck_pager_get_preferred_width_for_height;
@@ -288,11 +351,13 @@ wnck_pager_finalize (GObject *object)
 
   pager = WNCK_PAGER (object);
 
-  if (pager->priv->bg_cache)
-    {
-      g_object_unref (G_OBJECT (pager->priv->bg_cache));
-      pager->priv->bg_cache = NULL;
-    }
+  pager_instances = g_slist_remove (pager_instances, pager);
+
+  wnck_pager_invalidate_background (pager);
+
+  wnck_pager_clear_name_layouts (pager);
+  g_ptr_array_free (pager->priv->name_layouts, TRUE);
+  pager->priv->name_layouts = NULL;
 
   if (pager->priv->dnd_activate != 0)
     {
@@ -300,6 +365,13 @@ wnck_pager_finalize (GObject *object)
       pager->priv->dnd_activate = 0;
     }
 
+  if (pager->priv->accessible != NULL)
+    {
+      g_object_remove_weak_pointer (G_OBJECT (pager->priv->accessible),
+                                    (gpointer *) &pager->priv->accessible);
+      pager->priv->accessible = NULL;
+    }
+
   G_OBJECT_CLASS (wnck_pager_parent_class)->finalize (object);
 }
 
@@ -401,9 +473,83 @@ wnck_pager_unrealize (GtkWidget *widget)
   wnck_pager_disconnect_screen (pager);
   pager->priv->screen = NULL;
 
+  wnck_pager_clear_name_layouts (pager);
+  wnck_pager_invalidate_background (pager);
+
   GTK_WIDGET_CLASS (wnck_pager_parent_class)->unrealize (widget);
 }
 
+static void
+wnck_pager_style_updated (GtkWidget *widget)
+{
+  /* the font and the colors might have changed */
+  wnck_pager_clear_name_layouts (WNCK_PAGER (widget));
+  WNCK_PAGER (widget)->priv->state_colors_valid = FALSE;
+
+  GTK_WIDGET_CLASS (wnck_pager_parent_class)->style_updated (widget);
+}
+
+static void
+wnck_pager_direction_changed (GtkWidget        *widget,
+                              GtkTextDirection  previous_direction)
+{
+  wnck_pager_clear_name_layouts (WNCK_PAGER (widget));
+
+  GTK_WIDGET_CLASS (wnck_pager_parent_class)->direction_changed (widget,
+                                                                 previous_direction);
+}
+
+static PangoLayout *
+wnck_pager_get_name_layout (WnckPager *pager,
+                            int        workspace)
+{
+  PangoLayout *layout;
+
+  if ((guint) workspace >= pager->priv->name_layouts->len)
+    g_ptr_array_set_size (pager->priv->name_layouts, workspace + 1);
+
+  layout = g_ptr_array_index (pager->priv->name_layouts, workspace);
+
+  if (layout == NULL)
+    {
+      WnckWorkspace *space;
+
+      space = wnck_screen_get_workspace (pager->priv->screen, workspace);
+      layout = gtk_widget_create_pango_layout (GTK_WIDGET (pager),
+                                               space ? wnck_workspace_get_name (space) : NULL);
+      g_ptr_array_index (pager->priv->name_layouts, workspace) = layout;
+    }
+
+  return layout;
+}
+
+static void
+wnck_pager_clear_name_layout (WnckPager *pager,
+                              int        workspace)
+{
+  PangoLayout *layout;
+
+  if (workspace < 0 || (guint) workspace >= pager->priv->name_layouts->len)
+    return;
+
+  layout = g_ptr_array_index (pager->priv->name_layouts, workspace);
+  if (layout)
+    g_object_unref (layout);
+
+  g_ptr_array_index (pager->priv->name_layouts, workspace) = NULL;
+}
+
+static void
+wnck_pager_clear_name_layouts (WnckPager *pager)
+{
+  int i;
+
+  for (i = 0; i < (int) pager->priv->name_layouts->len; i++)
+    wnck_pager_clear_name_layout (pager, i);
+
+  g_ptr_array_set_size (pager->priv->name_layouts, 0);
+}
+
 static void
 _wnck_pager_get_padding (WnckPager *pager,
                          GtkBorder *padding)
@@ -453,27 +599,19 @@ _wnck_pager_get_workspace_width_for_height (WnckPager *pager,
     }
   else
     {
-      PangoLayout *layout;
-      WnckScreen *screen;
       int n_spaces;
       int i, w;
 
-      layout = gtk_widget_create_pango_layout  (GTK_WIDGET (pager), NULL);
-      screen = pager->priv->screen;
       n_spaces = wnck_screen_get_workspace_count (pager->priv->screen);
       workspace_width = 1;
 
       for (i = 0; i < n_spaces; i++)
 	{
-	  pango_layout_set_text (layout,
-				 wnck_workspace_get_name (wnck_screen_get_workspace (screen, i)),
-				 -1);
-	  pango_layout_get_pixel_size (layout, &w, NULL);
+	  pango_layout_get_pixel_size (wnck_pager_get_name_layout (pager, i),
+	                               &w, NULL);
 	  workspace_width = MAX (workspace_width, w);
 	}
 
-      g_object_unref (layout);
-
       workspace_width += 2;
     }
 
@@ -917,29 +1055,45 @@ wnck_pager_window_get_workspace (WnckWindow *window,
   return workspace ? wnck_workspace_get_number (workspace) : -1;
 }
 
+typedef struct
+{
+  int workspace_num;
+  int active_workspace_num;
+} WorkspaceFilter;
+
+/* Same as wnck_pager_window_get_workspace (window, TRUE) == workspace_num,
+ * but on the window record that the screen scans */
+static gboolean
+window_hot_is_on_workspace (const WnckWindowHot *hot,
+                            gpointer             data)
+{
+  WorkspaceFilter *filter = data;
+
+  if (hot->is_hidden || hot->skip_pager)
+    return FALSE;
+
+  if (hot->workspace == ALL_WORKSPACES)
+    return filter->active_workspace_num == filter->workspace_num;
+
+  return hot->workspace == filter->workspace_num;
+}
+
 static GList*
 get_windows_for_workspace_in_bottom_to_top (WnckScreen    *screen,
                                             WnckWorkspace *workspace)
 {
-  GList *result;
-  GList *windows;
-  GList *tmp;
-  int workspace_num;
-
-  result = NULL;
-  workspace_num = wnck_workspace_get_number (workspace);
+  WorkspaceFilter filter;
+  WnckWorkspace *active_space;
 
-  windows = wnck_screen_get_windows_stacked (screen);
-  for (tmp = windows; tmp != NULL; tmp = tmp->next)
-    {
-      WnckWindow *win = WNCK_WINDOW (tmp->data);
-      if (wnck_pager_window_get_workspace (win, TRUE) == workspace_num)
-	result = g_list_prepend (result, win);
-    }
+  active_space = wnck_screen_get_active_workspace (screen);
 
-  result = g_list_reverse (result);
+  filter.workspace_num = wnck_workspace_get_number (workspace);
+  filter.active_workspace_num = active_space ?
+                                wnck_workspace_get_number (active_space) : -1;
 
-  return result;
+  return _wnck_screen_filter_windows_stacked (screen,
+                                              window_hot_is_on_workspace,
+                                              &filter);
 }
 
 static void
@@ -986,22 +1140,72 @@ get_window_rect (WnckWindow         *window,
 }
 
 static void
-draw_window (cairo_t            *cr,
-             GtkWidget          *widget,
-             WnckWindow         *win,
-             const GdkRectangle *winrect,
-             GtkStateFlags       state,
-             gboolean            translucent)
+shade_color (const GdkRGBA *color,
+             gdouble        factor,
+             GdkRGBA       *shaded)
+{
+  GtkSymbolicColor *c1, *c2;
+
+  c1 = gtk_symbolic_color_new_literal (color);
+  c2 = gtk_symbolic_color_new_shade (c1, factor);
+  gtk_symbolic_color_resolve (c2, NULL, shaded);
+  gtk_symbolic_color_unref (c2);
+  gtk_symbolic_color_unref (c1);
+}
+
+static void
+compute_state_colors (GtkStyleContext      *context,
+                      GtkStateFlags         state,
+                      WnckPagerStateColors *colors)
+{
+  gtk_style_context_get_background_color (context, state, &colors->bg);
+  gtk_style_context_get_color (context, state, &colors->fg);
+
+  shade_color (&colors->bg, 1.3, &colors->active_bg);
+  shade_color (&colors->bg, 0.7, &colors->dark);
+}
+
+static const WnckPagerStateColors *
+wnck_pager_get_state_colors (WnckPager     *pager,
+                             GtkStateFlags  state)
+{
+  if (!pager->priv->state_colors_valid)
+    {
+      GtkStyleContext *context;
+
+      context = gtk_widget_get_style_context (GTK_WIDGET (pager));
+
+      compute_state_colors (context, GTK_STATE_FLAG_NORMAL,
+                            &pager->priv->state_colors[PAGER_STATE_NORMAL]);
+      compute_state_colors (context, GTK_STATE_FLAG_SELECTED,
+                            &pager->priv->state_colors[PAGER_STATE_SELECTED]);
+      compute_state_colors (context, GTK_STATE_FLAG_PRELIGHT,
+                            &pager->priv->state_colors[PAGER_STATE_PRELIGHT]);
+
+      pager->priv->state_colors_valid = TRUE;
+    }
+
+  if (state & GTK_STATE_FLAG_SELECTED)
+    return &pager->priv->state_colors[PAGER_STATE_SELECTED];
+  else if (state & GTK_STATE_FLAG_PRELIGHT)
+    return &pager->priv->state_colors[PAGER_STATE_PRELIGHT];
+  else
+    return &pager->priv->state_colors[PAGER_STATE_NORMAL];
+}
+
+static void
+draw_window (cairo_t                    *cr,
+             WnckWindow                 *win,
+             const GdkRectangle         *winrect,
+             const WnckPagerStateColors *colors,
+             gboolean                    translucent)
 {
-  GtkStyleContext *context;
   GdkPixbuf *icon;
   int icon_x, icon_y, icon_w, icon_h;
   gboolean is_active;
   GdkRGBA bg, fg;
   gdouble translucency;
 
-  context = gtk_widget_get_style_context (widget);
-
   is_active = wnck_window_is_active (win);
   translucency = translucent ? 0.4 : 1.0;
 
@@ -1009,16 +1213,10 @@ draw_window (cairo_t            *cr,
   cairo_rectangle (cr, winrect->x, winrect->y, winrect->width, winrect->height);
   cairo_clip (cr);
 
-  gtk_style_context_get_background_color (context, state, &bg);
-  if (is_active) {
-    GtkSymbolicColor *c1, *c2;
-
-    c1 = gtk_symbolic_color_new_literal (&bg);
-    c2 = gtk_symbolic_color_new_shade (c1, 1.3);
-    gtk_symbolic_color_resolve (c2, NULL, &bg);
-    gtk_symbolic_color_unref (c2);
-    gtk_symbolic_color_unref (c1);
-  }
+  if (is_active)
+    bg = colors->active_bg;
+  else
+    bg = colors->bg;
 
   bg.alpha = translucency;
   gdk_cairo_set_source_rgba (cr, &bg);
@@ -1070,7 +1268,7 @@ draw_window (cairo_t            *cr,
       cairo_restore (cr);
     }
 
-  gtk_style_context_get_color (context, state, &fg);
+  fg = colors->fg;
   fg.alpha = translucency;
   gdk_cairo_set_source_rgba (cr, &fg);
   cairo_set_line_width (cr, 1.0);
@@ -1218,24 +1416,6 @@ workspace_at_point (WnckPager *pager,
   return -1;
 }
 
-static void
-get_dark_color_for_state (GtkStyleContext *context,
-			  GtkStateFlags    state,
-			  GdkRGBA         *dark)
-{
-  GdkRGBA           bg;
-  GtkSymbolicColor *c1, *c2;
-
-  gtk_style_context_get_background_color (context, state, &bg);
-
-  c1 = gtk_symbolic_color_new_literal (&bg);
-
-  c2 = gtk_symbolic_color_new_shade (c1, 0.7);
-  gtk_symbolic_color_resolve (c2, NULL, dark);
-  gtk_symbolic_color_unref (c2);
-  gtk_symbolic_color_unref (c1);
-}
-
 static void
 wnck_pager_draw_workspace (WnckPager    *pager,
                            cairo_t      *cr,
@@ -1250,7 +1430,9 @@ wnck_pager_draw_workspace (WnckPager    *pager,
   GtkWidget *widget;
   GtkStateFlags state;
   GtkStyleContext *context;
-  GdkRGBA color;
+  const WnckPagerStateColors *colors;
+  const WnckPagerStateColors *normal_colors;
+  const WnckPagerStateColors *selected_colors;
 
   space = wnck_screen_get_workspace (pager->priv->screen, workspace);
   if (!space)
@@ -1267,6 +1449,10 @@ wnck_pager_draw_workspace (WnckPager    *pager,
 
   context = gtk_widget_get_style_context (widget);
 
+  colors = wnck_pager_get_state_colors (pager, state);
+  normal_colors = wnck_pager_get_state_colors (pager, GTK_STATE_FLAG_NORMAL);
+  selected_colors = wnck_pager_get_state_colors (pager, GTK_STATE_FLAG_SELECTED);
+
   /* FIXME in names mode, should probably draw things like a button.
    */
 
@@ -1279,8 +1465,7 @@ wnck_pager_draw_workspace (WnckPager    *pager,
     {
       if (!wnck_workspace_is_virtual (space))
         {
-	  get_dark_color_for_state (context, state, &color);
-          gdk_cairo_set_source_rgba (cr, &color);
+          gdk_cairo_set_source_rgba (cr, &colors->dark);
           cairo_rectangle (cr, rect->x, rect->y, rect->width, rect->height);
           cairo_fill (cr);
         }
@@ -1348,11 +1533,9 @@ wnck_pager_draw_workspace (WnckPager    *pager,
                         vh = rect->height + rect->y - vy;
 
                       if (active_i == i && active_j == j)
-			get_dark_color_for_state (context, GTK_STATE_FLAG_SELECTED, &color);
-		      else
-			get_dark_color_for_state (context, GTK_STATE_FLAG_NORMAL, &color);
-
-		      gdk_cairo_set_source_rgba (cr, &color);
+                        gdk_cairo_set_source_rgba (cr, &selected_colors->dark);
+                      else
+                        gdk_cairo_set_source_rgba (cr, &normal_colors->dark);
                       cairo_rectangle (cr, vx, vy, vw, vh);
                       cairo_fill (cr);
                     }
@@ -1364,8 +1547,7 @@ wnck_pager_draw_workspace (WnckPager    *pager,
               height_ratio = rect->height / (double) workspace_height;
 
               /* first draw non-active part of the viewport */
-	      get_dark_color_for_state (context, GTK_STATE_FLAG_NORMAL, &color);
-              gdk_cairo_set_source_rgba (cr, &color);
+              gdk_cairo_set_source_rgba (cr, &normal_colors->dark);
               cairo_rectangle (cr, rect->x, rect->y, rect->width, rect->height);
               cairo_fill (cr);
 
@@ -1379,8 +1561,7 @@ wnck_pager_draw_workspace (WnckPager    *pager,
                   vw = width_ratio * screen_width;
                   vh = height_ratio * screen_height;
 
-		  get_dark_color_for_state (context, GTK_STATE_FLAG_SELECTED, &color);
-                  gdk_cairo_set_source_rgba (cr, &color);
+                  gdk_cairo_set_source_rgba (cr, &selected_colors->dark);
                   cairo_rectangle (cr, vx, vy, vw, vh);
                   cairo_fill (cr);
                 }
@@ -1403,10 +1584,9 @@ wnck_pager_draw_workspace (WnckPager    *pager,
 	  get_window_rect (win, rect, &winrect);
 
 	  draw_window (cr,
-		       widget,
 		       win,
 		       &winrect,
-                       state,
+		       colors,
 		       win == pager->priv->drag_window && pager->priv->dragging ? TRUE : FALSE);
 
 	  tmp = tmp->next;
@@ -1417,29 +1597,22 @@ wnck_pager_draw_workspace (WnckPager    *pager,
   else
     {
       /* Workspace name mode */
-      const char *workspace_name;
       PangoLayout *layout;
       int w, h;
 
-      workspace_name = wnck_workspace_get_name (wnck_screen_get_workspace (pager->priv->screen,
-									   workspace));
-      layout = gtk_widget_create_pango_layout  (widget,
-						workspace_name);
+      layout = wnck_pager_get_name_layout (pager, workspace);
 
       pango_layout_get_pixel_size (layout, &w, &h);
 
       if (is_current)
-	gtk_style_context_get_color (context, GTK_STATE_FLAG_SELECTED, &color);
+        gdk_cairo_set_source_rgba (cr, &selected_colors->fg);
       else
-	gtk_style_context_get_color (context, GTK_STATE_FLAG_NORMAL, &color);
-      gdk_cairo_set_source_rgba (cr, &color);
+        gdk_cairo_set_source_rgba (cr, &normal_colors->fg);
       cairo_move_to (cr,
                      rect->x + (rect->width - w) / 2,
                      rect->y + (rect->height - h) / 2);
 
       pango_cairo_show_layout (cr, layout);
-
-      g_object_unref (layout);
     }
 
   if (workspace == pager->priv->prelight && pager->priv->prelight_dnd)
@@ -1846,6 +2019,7 @@ wnck_update_drag_icon (WnckWindow     *window,
   GdkRectangle rect;
   cairo_surface_t *surface;
   GtkWidget *widget;
+  WnckPagerStateColors colors;
   cairo_t *cr;
 
   widget = g_object_get_data (G_OBJECT (context), "wnck-drag-source-widget");
@@ -1878,9 +2052,12 @@ wnck_update_drag_icon (WnckWindow     *window,
   surface = gdk_window_create_similar_surface (gtk_widget_get_window (widget),
                                                CAIRO_CONTENT_COLOR,
                                                rect.width, rect.height);
+  /* widget might not be a pager, so we can't use its cached colors */
+  compute_state_colors (gtk_widget_get_style_context (widget),
+                        GTK_STATE_FLAG_NORMAL, &colors);
+
   cr = cairo_create (surface);
-  draw_window (cr, widget, window,
-	       &rect, GTK_STATE_FLAG_NORMAL, FALSE);
+  draw_window (cr, window, &rect, &colors, FALSE);
   cairo_destroy (cr);
   cairo_surface_set_device_offset (surface, 2, 2);
 
@@ -2512,6 +2689,9 @@ workspace_created_callback        (WnckScreen      *screen,
   WnckPager *pager = WNCK_PAGER (data);
   g_signal_connect (space, "name_changed",
                     G_CALLBACK (workspace_name_changed_callback), pager);
+  wnck_pager_clear_name_layouts (pager);
+  if (pager->priv->accessible)
+    _wnck_pager_accessible_workspaces_changed (pager->priv->accessible);
   gtk_widget_queue_resize (GTK_WIDGET (pager));
 }
 
@@ -2522,6 +2702,9 @@ workspace_destroyed_callback      (WnckScreen      *screen,
 {
   WnckPager *pager = WNCK_PAGER (data);
   g_signal_handlers_disconnect_by_func (space, G_CALLBACK (workspace_name_changed_callback), pager);
+  wnck_pager_clear_name_layouts (pager);
+  if (pager->priv->accessible)
+    _wnck_pager_accessible_workspaces_changed (pager->priv->accessible);
   gtk_widget_queue_resize (GTK_WIDGET (pager));
 }
 
@@ -2599,11 +2782,7 @@ background_changed_callback (WnckWindow *window,
 {
   WnckPager *pager = WNCK_PAGER (data);
 
-  if (pager->priv->bg_cache)
-    {
-      g_object_unref (G_OBJECT (pager->priv->bg_cache));
-      pager->priv->bg_cache = NULL;
-    }
+  wnck_pager_invalidate_background (pager);
 
   gtk_widget_queue_draw (GTK_WIDGET (pager));
 }
@@ -2612,6 +2791,8 @@ static void
 workspace_name_changed_callback (WnckWorkspace *space,
                                  gpointer       data)
 {
+  wnck_pager_clear_name_layout (WNCK_PAGER (data),
+                                wnck_workspace_get_number (space));
   gtk_widget_queue_resize (GTK_WIDGET (data));
 }
 
@@ -2797,60 +2978,270 @@ wnck_pager_clear_drag (WnckPager *pager)
   pager->priv->drag_start_y = -1;
 }
 
-static GdkPixbuf*
-wnck_pager_get_background (WnckPager *pager,
-                           int        width,
-                           int        height)
+/* The background thumbnail is built in three steps, none of them in the
+ * draw path:
+ *  - in an idle, the background pixmap is copied to client memory (this
+ *    needs the X connection, so it has to be done in the main thread);
+ *  - in a worker thread, it is downscaled with a box filter;
+ *  - back in the main thread, the result is cached and the pager redrawn.
+ * bg_generation is bumped each time the background or the requested size
+ * change, so that results of outdated jobs are dropped.
+ */
+typedef struct
 {
-  Pixmap p;
-  GdkPixbuf *pix = NULL;
+  WnckPager       *pager;
+  guint            generation;
+  cairo_surface_t *source;
+  int              width;
+  int              height;
+  GdkPixbuf       *result;
+} WnckPagerBackgroundJob;
 
-  /* We have to be careful not to keep alternating between
-   * width/height values, otherwise this would get really slow.
-   */
-  if (pager->priv->bg_cache &&
-      gdk_pixbuf_get_width (pager->priv->bg_cache) == width &&
-      gdk_pixbuf_get_height (pager->priv->bg_cache) == height)
-    return pager->priv->bg_cache;
+#define MIN_BG_SIZE 10
 
-  if (pager->priv->bg_cache)
+static gboolean wnck_pager_background_job_done (gpointer data);
+
+/* Averages each box of source pixels covered by a destination pixel. This is
+ * much cheaper than a bilinear or hyperbolic scale for the large reduction
+ * factors we have here, and gives better results than nearest sampling.
+ */
+static void
+box_filter_downscale (const guchar *src,
+                      int           src_width,
+                      int           src_height,
+                      int           src_stride,
+                      guchar       *dest,
+                      int           dest_width,
+                      int           dest_height,
+                      int           dest_stride,
+                      int           dest_n_channels)
+{
+  int     *x_bounds;
+  guint32 *sums;
+  int      dx, dy, x, y;
+
+  x_bounds = g_new (int, dest_width + 1);
+  for (dx = 0; dx <= dest_width; dx++)
+    x_bounds[dx] = (gint64) dx * src_width / dest_width;
+
+  sums = g_new (guint32, dest_width * 3);
+
+  for (dy = 0; dy < dest_height; dy++)
     {
-      g_object_unref (G_OBJECT (pager->priv->bg_cache));
-      pager->priv->bg_cache = NULL;
+      int     y0, y1;
+      guchar *dest_row;
+
+      y0 = (gint64) dy * src_height / dest_height;
+      y1 = (gint64) (dy + 1) * src_height / dest_height;
+      y1 = CLAMP (y1, y0 + 1, src_height);
+
+      memset (sums, 0, dest_width * 3 * sizeof (guint32));
+
+      for (y = y0; y < y1; y++)
+        {
+          const guint32 *src_row;
+
+          src_row = (const guint32 *) (src + y * src_stride);
+
+          for (dx = 0; dx < dest_width; dx++)
+            {
+              int x1;
+
+              x1 = CLAMP (x_bounds[dx + 1], x_bounds[dx] + 1, src_width);
+
+              for (x = x_bounds[dx]; x < x1; x++)
+                {
+                  guint32 pixel = src_row[x];
+
+                  sums[dx * 3 + 0] += (pixel >> 16) & 0xff;
+                  sums[dx * 3 + 1] += (pixel >> 8) & 0xff;
+                  sums[dx * 3 + 2] += pixel & 0xff;
+                }
+            }
+        }
+
+      dest_row = dest + dy * dest_stride;
+
+      for (dx = 0; dx < dest_width; dx++)
+        {
+          guint32 n;
+
+          n = (CLAMP (x_bounds[dx + 1], x_bounds[dx] + 1, src_width) - x_bounds[dx])
+              * (y1 - y0);
+
+          dest_row[dx * dest_n_channels + 0] = sums[dx * 3 + 0] / n;
+          dest_row[dx * dest_n_channels + 1] = sums[dx * 3 + 1] / n;
+          dest_row[dx * dest_n_channels + 2] = sums[dx * 3 + 2] / n;
+        }
     }
 
-  if (pager->priv->screen == NULL)
-    return NULL;
+  g_free (sums);
+  g_free (x_bounds);
+}
 
-  /* FIXME this just globally disables the thumbnailing feature */
-  return NULL;
+/* Runs in a worker thread: only touches the job */
+static void
+wnck_pager_background_job_run (gpointer data,
+                               gpointer user_data)
+{
+  WnckPagerBackgroundJob *job = data;
+  GdkPixbuf *pixbuf;
 
-#define MIN_BG_SIZE 10
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8,
+                           job->width, job->height);
 
-  if (width < MIN_BG_SIZE || height < MIN_BG_SIZE)
-    return NULL;
+  if (pixbuf)
+    box_filter_downscale (cairo_image_surface_get_data (job->source),
+                          cairo_image_surface_get_width (job->source),
+                          cairo_image_surface_get_height (job->source),
+                          cairo_image_surface_get_stride (job->source),
+                          gdk_pixbuf_get_pixels (pixbuf),
+                          job->width,
+                          job->height,
+                          gdk_pixbuf_get_rowstride (pixbuf),
+                          gdk_pixbuf_get_n_channels (pixbuf));
+
+  cairo_surface_destroy (job->source);
+  job->source = NULL;
+  job->result = pixbuf;
+
+  g_idle_add (wnck_pager_background_job_done, job);
+}
+
+/* Back in the main thread */
+static gboolean
+wnck_pager_background_job_done (gpointer data)
+{
+  WnckPagerBackgroundJob *job = data;
+  WnckPager *pager = job->pager;
+
+  if (job->generation == pager->priv->bg_generation && job->result)
+    {
+      if (pager->priv->bg_cache)
+        g_object_unref (G_OBJECT (pager->priv->bg_cache));
+      pager->priv->bg_cache = job->result;
+      job->result = NULL;
+
+      gtk_widget_queue_draw (GTK_WIDGET (pager));
+    }
+
+  if (job->result)
+    g_object_unref (G_OBJECT (job->result));
+  g_object_unref (pager);
+  g_slice_free (WnckPagerBackgroundJob, job);
+
+  return FALSE;
+}
+
+static gboolean
+wnck_pager_background_fetch_idle (gpointer data)
+{
+  WnckPager *pager = WNCK_PAGER (data);
+  WnckPagerBackgroundJob *job;
+  cairo_surface_t *source;
+  Pixmap p;
+#if GLIB_CHECK_VERSION (2, 32, 0)
+  static GThreadPool *pool = NULL;
+#endif
+
+  pager->priv->bg_fetch_idle = 0;
+
+  if (pager->priv->screen == NULL)
+    return FALSE;
 
   p = wnck_screen_get_background_pixmap (pager->priv->screen);
+  if (p == None)
+    return FALSE;
+
+  source = _wnck_cairo_image_surface_get_from_pixmap (WNCK_SCREEN_XSCREEN (pager->priv->screen),
+                                                      p);
+  if (source == NULL)
+    return FALSE;
+
+  job = g_slice_new0 (WnckPagerBackgroundJob);
+  job->pager = g_object_ref (pager);
+  job->generation = pager->priv->bg_generation;
+  job->source = source;
+  job->width = pager->priv->bg_width;
+  job->height = pager->priv->bg_height;
+
+#if GLIB_CHECK_VERSION (2, 32, 0)
+  if (pool == NULL)
+    pool = g_thread_pool_new (wnck_pager_background_job_run, NULL,
+                              1, FALSE, NULL);
+
+  g_thread_pool_push (pool, job, NULL);
+#else
+  /* threads might not be initialized: do it here, it's still out of the
+   * draw path */
+  wnck_pager_background_job_run (job, NULL);
+#endif
+
+  return FALSE;
+}
+
+static void
+wnck_pager_invalidate_background (WnckPager *pager)
+{
+  pager->priv->bg_generation++;
+  pager->priv->bg_width = -1;
+  pager->priv->bg_height = -1;
 
-  if (p != None)
+  if (pager->priv->bg_fetch_idle != 0)
     {
-      Screen *xscreen;
+      g_source_remove (pager->priv->bg_fetch_idle);
+      pager->priv->bg_fetch_idle = 0;
+    }
 
-      xscreen = WNCK_SCREEN_XSCREEN (pager->priv->screen);
-      pix = _wnck_gdk_pixbuf_get_from_pixmap (xscreen, p);
+  if (pager->priv->bg_cache)
+    {
+      g_object_unref (G_OBJECT (pager->priv->bg_cache));
+      pager->priv->bg_cache = NULL;
     }
+}
+
+void
+_wnck_pager_add_memory_usage (WnckMemoryUsage *usage,
+                              GHashTable      *pixbufs)
+{
+  GSList *l;
 
-  if (pix)
+  for (l = pager_instances; l != NULL; l = l->next)
     {
-      pager->priv->bg_cache = gdk_pixbuf_scale_simple (pix,
-                                                       width,
-                                                       height,
-                                                       GDK_INTERP_BILINEAR);
+      WnckPager *pager = WNCK_PAGER (l->data);
 
-      g_object_unref (G_OBJECT (pix));
+      _wnck_memory_usage_add_pixbuf (usage, pixbufs, pager->priv->bg_cache);
     }
+}
+
+static GdkPixbuf*
+wnck_pager_get_background (WnckPager *pager,
+                           int        width,
+                           int        height)
+{
+  /* We have to be careful not to keep alternating between
+   * width/height values, otherwise this would get really slow.
+   */
+  if (pager->priv->bg_width == width &&
+      pager->priv->bg_height == height)
+    return pager->priv->bg_cache;
 
-  return pager->priv->bg_cache;
+  wnck_pager_invalidate_background (pager);
+
+  if (pager->priv->screen == NULL)
+    return NULL;
+
+  if (width < MIN_BG_SIZE || height < MIN_BG_SIZE)
+    return NULL;
+
+  /* The thumbnail will be ready for a later draw */
+  pager->priv->bg_width = width;
+  pager->priv->bg_height = height;
+  pager->priv->bg_fetch_idle = g_idle_add_full (G_PRIORITY_LOW,
+                                                wnck_pager_background_fetch_idle,
+                                                pager, NULL);
+
+  return NULL;
 }
 
 /*
@@ -2860,6 +3251,8 @@ static AtkObject *
 wnck_pager_get_accessible (GtkWidget *widget)
 {
   static gboolean first_time = TRUE;
+  WnckPager *pager;
+  AtkObject *accessible;
 
   if (first_time)
     {
@@ -2896,7 +3289,20 @@ wnck_pager_get_accessible (GtkWidget *widget)
         }
       first_time = FALSE;
     }
-  return GTK_WIDGET_CLASS (wnck_pager_parent_class)->get_accessible (widget);
+
+  accessible = GTK_WIDGET_CLASS (wnck_pager_parent_class)->get_accessible (widget);
+
+  /* remember it so that workspace_created_callback() and
+   * workspace_destroyed_callback() can keep its children in sync */
+  pager = WNCK_PAGER (widget);
+  if (pager->priv->accessible == NULL && WNCK_PAGER_IS_ACCESSIBLE (accessible))
+    {
+      pager->priv->accessible = accessible;
+      g_object_add_weak_pointer (G_OBJECT (accessible),
+                                 (gpointer *) &pager->priv->accessible);
+    }
+
+  return accessible;
 }
 
 int
@@ -40,6 +40,62 @@ G_BEGIN_DECLS
 
 #define WNCK_ACTIVATE_TIMEOUT 1000
 
+/* The part of the state of a WnckWindow that scans over all windows
+ * (pager drawing, tasklist filtering, selector bucketing) read. The records
+ * of the windows of a screen are allocated by the screen in blocks, so that
+ * those scans walk contiguous memory; see _wnck_screen_filter_windows().
+ */
+typedef struct _WnckWindowHot WnckWindowHot;
+
+/* value of the workspace of a pinned window */
+#define ALL_WORKSPACES (0xFFFFFFFF)
+
+struct _WnckWindowHot
+{
+  WnckWindow *window; /* NULL for a free record */
+  Window transient_for;
+  GdkPixbuf *icon;
+  GdkPixbuf *mini_icon;
+  int workspace;
+  /* position in the stacking order of the screen, -1 if not stacked */
+  int stack_position;
+  int x;
+  int y;
+  int width;
+  int height;
+  /* monitor containing the center of the window, -1 if unknown */
+  int monitor;
+  WnckWindowType wintype;
+
+  /* true if transient_for points to root window,
+   * not another app window
+   */
+  guint transient_for_root : 1;
+
+  /* true if the window is in _NET_CLIENT_LIST, false for the windows created
+   * by wnck_screen_force_update_window() that have not been announced yet
+   */
+  guint listed : 1;
+
+  /* window state */
+  guint is_minimized : 1;
+  guint is_maximized_horz : 1;
+  guint is_maximized_vert : 1;
+  guint is_shaded : 1;
+  guint is_above : 1;
+  guint is_below : 1;
+  guint skip_pager : 1;
+  guint skip_taskbar : 1;
+  guint is_sticky : 1;
+  guint is_hidden : 1;
+  guint is_fullscreen : 1;
+  guint demands_attention : 1;
+  guint is_urgent : 1;
+};
+
+typedef gboolean (* WnckWindowHotFilter) (const WnckWindowHot *hot,
+                                          gpointer             data);
+
 WnckClientType _wnck_get_client_type (void);
 
 void _wnck_application_process_property_notify (WnckApplication *app,
@@ -51,15 +107,29 @@ void _wnck_screen_process_property_notify (WnckScreen *screen,
                                            XEvent     *xevent);
 void _wnck_window_process_configure_notify (WnckWindow *window,
                                             XEvent     *xevent);
+void _wnck_window_process_frame_configure_notify (WnckWindow *window,
+                                                  XEvent     *xevent);
+void _wnck_window_process_reparent_notify (WnckWindow *window,
+                                           XEvent     *xevent);
+GSList*     _wnck_window_get_for_frame (Window frame);
 WnckWindow* _wnck_window_create  (Window      xwindow,
                                   WnckScreen *screen,
                                   gint        sort_order);
 void        _wnck_window_destroy (WnckWindow *window);
+void        _wnck_window_process_queued_update (WnckWindow *window);
 
 char*       _wnck_window_get_name_for_display (WnckWindow *window,
                                                gboolean    use_icon_name,
                                                gboolean    use_state_decorations);
 const char* _wnck_window_get_startup_id (WnckWindow *window);
+Window      _wnck_window_get_transient_for_xid (WnckWindow *window);
+const WnckWindowHot* _wnck_window_get_hot (WnckWindow *window);
+void        _wnck_window_set_stack_position (WnckWindow *window,
+                                             int         position);
+void        _wnck_window_set_listed         (WnckWindow *window,
+                                             gboolean    listed);
+void        _wnck_window_set_monitor        (WnckWindow *window,
+                                             int         monitor);
 
 time_t      _wnck_window_get_needs_attention_time (WnckWindow *window);
 time_t      _wnck_window_or_transient_get_needs_attention_time (WnckWindow *window);
@@ -109,12 +179,66 @@ void _wnck_screen_change_workspace_name (WnckScreen *screen,
 
 void _wnck_screen_shutdown_all          (void);
 
+void _wnck_screen_record_window_change  (WnckScreen          *screen,
+                                         WnckWindow          *window,
+                                         WnckWindowChangeMask change,
+                                         gint64               handler_time);
+void _wnck_screen_forget_window_changes (WnckScreen *screen,
+                                         WnckWindow *window);
+void _wnck_screen_queue_window_update   (WnckScreen *screen,
+                                         WnckWindow *window);
+
+void   _wnck_screen_set_transient_for     (WnckScreen *screen,
+                                           WnckWindow *window,
+                                           Window      old_parent,
+                                           Window      new_parent);
+GList* _wnck_screen_get_transients        (WnckScreen *screen,
+                                           Window      xwindow);
+void   _wnck_screen_invalidate_transients (WnckScreen *screen);
+void   _wnck_screen_update_window_monitor (WnckScreen *screen,
+                                           WnckWindow *window);
+guint  _wnck_screen_get_transients_serial (WnckScreen *screen);
+
+WnckWindowHot* _wnck_screen_alloc_window_hot       (WnckScreen          *screen);
+void           _wnck_screen_free_window_hot        (WnckScreen          *screen,
+                                                    WnckWindowHot       *hot);
+GList*         _wnck_screen_filter_windows         (WnckScreen          *screen,
+                                                    WnckWindowHotFilter  filter,
+                                                    gpointer             data);
+GList*         _wnck_screen_filter_windows_stacked (WnckScreen          *screen,
+                                                    WnckWindowHotFilter  filter,
+                                                    gpointer             data);
+
 gboolean _wnck_workspace_set_geometry (WnckWorkspace *space, int w, int h);
 gboolean _wnck_workspace_set_viewport (WnckWorkspace *space, int x, int y);
 
 void _wnck_init (void);
 Display *_wnck_get_default_display (void);
 
+const char *_wnck_intern_string      (const char *str);
+const char *_wnck_intern_string_take (char       *str);
+void        _wnck_intern_release     (const char *str);
+const char *_wnck_intern_lookup      (const char *str);
+
+void _wnck_memory_usage_add_pixbuf      (WnckMemoryUsage *usage,
+                                         GHashTable      *pixbufs,
+                                         GdkPixbuf       *pixbuf);
+void _wnck_screen_add_memory_usage      (WnckMemoryUsage *usage);
+void _wnck_window_add_memory_usage      (WnckMemoryUsage *usage,
+                                         GHashTable      *pixbufs);
+void _wnck_application_add_memory_usage (WnckMemoryUsage *usage,
+                                         GHashTable      *pixbufs);
+void _wnck_class_group_add_memory_usage (WnckMemoryUsage *usage,
+                                         GHashTable      *pixbufs);
+void _wnck_tasklist_add_memory_usage    (WnckMemoryUsage *usage);
+void _wnck_pager_add_memory_usage       (WnckMemoryUsage *usage,
+                                         GHashTable      *pixbufs);
+void _wnck_icon_variants_add_memory_usage  (WnckMemoryUsage *usage,
+                                            GHashTable      *pixbufs,
+                                            GdkPixbuf       *source);
+void _wnck_fallback_icons_add_memory_usage (WnckMemoryUsage *usage,
+                                            GHashTable      *pixbufs);
+
 #define DEFAULT_ICON_WIDTH 32
 #define DEFAULT_ICON_HEIGHT 32
 #define DEFAULT_MINI_ICON_WIDTH 16
@@ -35,6 +35,7 @@
 #include "class-group.h"
 #include "xutils.h"
 #include "private.h"
+#include "wnck-marshal.h"
 #include <gdk/gdk.h>
 #include <gdk/gdkx.h>
 #include <string.h>
@@ -67,6 +68,12 @@
 #define _NET_WM_BOTTOMRIGHT 2
 #define _NET_WM_BOTTOMLEFT  3
 
+/* number of bits in WnckWindowChangeMask */
+#define N_WINDOW_CHANGES 7
+
+/* number of WnckWindowHot records allocated at once */
+#define WINDOW_HOT_BLOCK_SIZE 64
+
 static WnckScreen** screens = NULL;
 
 struct _WnckScreenPrivate
@@ -84,6 +91,29 @@ struct _WnckScreenPrivate
   /* in 0-to-N order */
   GList *workspaces;
 
+  /* windows, applications and class groups created by
+   * wnck_screen_force_update_window() that the next update of the client
+   * list has not announced yet */
+  GHashTable *unlisted;
+
+  /* X window => GList of the WnckWindow that are transient for it, see
+   * _wnck_screen_get_transients(); transients_serial changes whenever the
+   * result of a walk along transients could change */
+  GHashTable *transients;
+  guint transients_serial;
+
+  /* geometry of the monitors of the GdkScreen, to assign windows to
+   * monitors without asking GDK on each geometry change */
+  GdkScreen *gdk_screen;
+  GdkRectangle *monitors;
+  int n_monitors;
+  gulong monitors_changed_handler;
+
+  /* blocks of WINDOW_HOT_BLOCK_SIZE WnckWindowHot records, and the free
+   * records among them */
+  GPtrArray *window_hot_blocks;
+  GSList *free_window_hot;
+
   /* previously_active_window is used in tandem with active_window to
    * determine return status of wnck_window_is_most_recently_actived().
    * These are usually shared for all screens, although this is not guaranteed
@@ -103,7 +133,23 @@ struct _WnckScreenPrivate
 
   char *wm_name;
 
+  /* idle handler for the updates of the screen and of its windows */
   guint update_handler;
+  /* windows, with a reference, for which queue_update() was called in
+   * window.c; see _wnck_screen_queue_window_update() */
+  GQueue *dirty_windows;
+  /* in milliseconds, 0 for no limit */
+  guint update_budget;
+
+  /* pending WnckWindowChange for changes-batched, and a map from each
+   * WnckWindow to its position (plus one) in this array */
+  GArray     *batched_changes;
+  GHashTable *batched_changes_index;
+  guint       batch_handler;
+
+  /* indexed by the bit number in WnckWindowChangeMask */
+  guint   change_emissions[N_WINDOW_CHANGES];
+  guint64 change_handler_time[N_WINDOW_CHANGES];
 
 #ifdef HAVE_STARTUP_NOTIFICATION
   SnDisplay *sn_display;
@@ -111,6 +157,11 @@ struct _WnckScreenPrivate
 
   guint showing_desktop : 1;
 
+  guint batch_changes : 1;
+
+  /* screen state needs to be updated in the idle handler */
+  guint update_queued : 1;
+
   guint vertical_workspaces : 1;
   _WnckLayoutCorner starting_corner;
   gint rows_of_workspaces;
@@ -150,6 +201,7 @@ enum {
   SHOWING_DESKTOP_CHANGED,
   VIEWPORTS_CHANGED,
   WM_CHANGED,
+  CHANGES_BATCHED,
   LAST_SIGNAL
 };
 
@@ -169,6 +221,9 @@ static void update_showing_desktop    (WnckScreen      *screen);
 static void queue_update            (WnckScreen      *screen);
 static void unqueue_update          (WnckScreen      *screen);
 static void do_update_now           (WnckScreen      *screen);
+static void do_update_workspaces_now (WnckScreen     *screen);
+
+static void unqueue_batch           (WnckScreen      *screen);
 
 static void emit_active_window_changed    (WnckScreen      *screen);
 static void emit_active_workspace_changed (WnckScreen      *screen,
@@ -194,6 +249,7 @@ static void emit_background_changed       (WnckScreen      *screen);
 static void emit_showing_desktop_changed  (WnckScreen      *screen);
 static void emit_viewports_changed        (WnckScreen      *screen);
 static void emit_wm_changed               (WnckScreen *screen);
+static void emit_changes_batched          (WnckScreen      *screen);
 
 static guint signals[LAST_SIGNAL] = { 0 };
 
@@ -210,6 +266,21 @@ wnck_screen_init (WnckScreen *screen)
   screen->priv->stacked_windows = NULL;
   screen->priv->workspaces = NULL;
 
+  screen->priv->unlisted = NULL;
+
+  screen->priv->transients = g_hash_table_new_full (_wnck_xid_hash,
+                                                    _wnck_xid_equal,
+                                                    g_free, NULL);
+  screen->priv->transients_serial = 1;
+
+  screen->priv->window_hot_blocks = g_ptr_array_new ();
+  screen->priv->free_window_hot = NULL;
+
+  screen->priv->gdk_screen = NULL;
+  screen->priv->monitors = NULL;
+  screen->priv->n_monitors = 0;
+  screen->priv->monitors_changed_handler = 0;
+
   screen->priv->active_window = NULL;
   screen->priv->previously_active_window = NULL;
 
@@ -222,6 +293,18 @@ wnck_screen_init (WnckScreen *screen)
   screen->priv->wm_name = NULL;
 
   screen->priv->update_handler = 0;
+  screen->priv->dirty_windows = g_queue_new ();
+  screen->priv->update_budget = 0;
+  screen->priv->update_queued = FALSE;
+
+  screen->priv->batched_changes = NULL;
+  screen->priv->batched_changes_index = NULL;
+  screen->priv->batch_handler = 0;
+
+  memset (screen->priv->change_emissions, 0,
+          sizeof (screen->priv->change_emissions));
+  memset (screen->priv->change_handler_time, 0,
+          sizeof (screen->priv->change_handler_time));
 
 #ifdef HAVE_STARTUP_NOTIFICATION
   screen->priv->sn_display = NULL;
@@ -229,6 +312,8 @@ wnck_screen_init (WnckScreen *screen)
 
   screen->priv->showing_desktop = FALSE;
 
+  screen->priv->batch_changes = FALSE;
+
   screen->priv->vertical_workspaces = FALSE;
   screen->priv->starting_corner = WNCK_LAYOUT_CORNER_TOPLEFT;
   screen->priv->rows_of_workspaces = 1;
@@ -504,6 +589,33 @@ wnck_screen_class_init (WnckScreenClass *klass)
                   NULL, NULL,
                   g_cclosure_marshal_VOID__VOID,
                   G_TYPE_NONE, 0);
+
+  /**
+   * WnckScreen::changes-batched:
+   * @screen: the #WnckScreen which emitted the signal.
+   * @changes: array of #WnckWindowChange.
+   * @n_changes: number of elements in @changes.
+   *
+   * Emitted at most once per main loop iteration, when batching is enabled on
+   * @screen with wnck_screen_set_batch_changes(), with all the changes that
+   * happened on #WnckWindow of @screen since the previous emission. Each
+   * #WnckWindow appears at most once in @changes. @changes is only valid
+   * during the emission.
+   *
+   * The per-window signals (like #WnckWindow::name-changed) are still
+   * emitted: a consumer of this signal does not need to connect to them.
+   *
+   * Since: 3.4
+   */
+  signals[CHANGES_BATCHED] =
+    g_signal_new ("changes_batched",
+                  G_OBJECT_CLASS_TYPE (object_class),
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (WnckScreenClass, changes_batched),
+                  NULL, NULL,
+                  _wnck_marshal_VOID__POINTER_UINT,
+                  G_TYPE_NONE, 2,
+                  G_TYPE_POINTER, G_TYPE_UINT);
 }
 
 static void
@@ -520,7 +632,27 @@ wnck_screen_finalize (GObject *object)
                       screen->priv->orig_event_mask,
                       FALSE);
 
+  if (screen->priv->monitors_changed_handler != 0)
+    g_signal_handler_disconnect (screen->priv->gdk_screen,
+                                 screen->priv->monitors_changed_handler);
+  screen->priv->monitors_changed_handler = 0;
+  screen->priv->gdk_screen = NULL;
+
+  g_free (screen->priv->monitors);
+  screen->priv->monitors = NULL;
+  screen->priv->n_monitors = 0;
+
   unqueue_update (screen);
+  g_queue_free (screen->priv->dirty_windows);
+  screen->priv->dirty_windows = NULL;
+
+  unqueue_batch (screen);
+  if (screen->priv->batched_changes)
+    g_array_free (screen->priv->batched_changes, TRUE);
+  screen->priv->batched_changes = NULL;
+  if (screen->priv->batched_changes_index)
+    g_hash_table_destroy (screen->priv->batched_changes_index);
+  screen->priv->batched_changes_index = NULL;
 
   for (tmp = screen->priv->stacked_windows; tmp; tmp = tmp->next)
     {
@@ -532,6 +664,32 @@ wnck_screen_finalize (GObject *object)
   for (tmp = screen->priv->mapped_windows; tmp; tmp = tmp->next)
     _wnck_window_destroy (WNCK_WINDOW (tmp->data));
 
+  if (screen->priv->unlisted)
+    {
+      GList *unlisted;
+
+      unlisted = g_hash_table_get_keys (screen->priv->unlisted);
+      for (tmp = unlisted; tmp; tmp = tmp->next)
+        if (WNCK_IS_WINDOW (tmp->data))
+          _wnck_window_destroy (WNCK_WINDOW (tmp->data));
+      g_list_free (unlisted);
+
+      g_hash_table_destroy (screen->priv->unlisted);
+      screen->priv->unlisted = NULL;
+    }
+
+  /* after destroying the windows, since they remove themselves from it:
+   * it is empty now */
+  g_hash_table_destroy (screen->priv->transients);
+  screen->priv->transients = NULL;
+
+  /* the windows have detached their records too */
+  g_slist_free (screen->priv->free_window_hot);
+  screen->priv->free_window_hot = NULL;
+  g_ptr_array_foreach (screen->priv->window_hot_blocks, (GFunc) g_free, NULL);
+  g_ptr_array_free (screen->priv->window_hot_blocks, TRUE);
+  screen->priv->window_hot_blocks = NULL;
+
   for (tmp = screen->priv->workspaces; tmp; tmp = tmp->next)
     g_object_unref (tmp->data);
 
@@ -584,6 +742,32 @@ sn_error_trap_pop (SnDisplay *display,
 }
 #endif /* HAVE_STARTUP_NOTIFICATION */
 
+static void
+update_monitors (WnckScreen *screen)
+{
+  int i;
+
+  screen->priv->n_monitors = gdk_screen_get_n_monitors (screen->priv->gdk_screen);
+  screen->priv->monitors = g_renew (GdkRectangle, screen->priv->monitors,
+                                    screen->priv->n_monitors);
+
+  for (i = 0; i < screen->priv->n_monitors; i++)
+    gdk_screen_get_monitor_geometry (screen->priv->gdk_screen, i,
+                                     &screen->priv->monitors[i]);
+}
+
+static void
+monitors_changed_callback (GdkScreen  *gdk_screen,
+                           WnckScreen *screen)
+{
+  GList *tmp;
+
+  update_monitors (screen);
+
+  for (tmp = screen->priv->mapped_windows; tmp; tmp = tmp->next)
+    _wnck_screen_update_window_monitor (screen, WNCK_WINDOW (tmp->data));
+}
+
 static void
 wnck_screen_construct (Display    *display,
                        WnckScreen *screen,
@@ -602,6 +786,15 @@ wnck_screen_construct (Display    *display,
 
   screen->priv->bg_pixmap = None;
 
+  screen->priv->gdk_screen = _wnck_screen_get_gdk_screen (screen);
+  if (screen->priv->gdk_screen != NULL)
+    {
+      update_monitors (screen);
+      screen->priv->monitors_changed_handler =
+        g_signal_connect (screen->priv->gdk_screen, "monitors-changed",
+                          G_CALLBACK (monitors_changed_callback), screen);
+    }
+
   screen->priv->orig_event_mask = _wnck_select_input (screen->priv->xscreen,
                                                       screen->priv->xroot,
                                                       PropertyChangeMask,
@@ -948,6 +1141,168 @@ wnck_screen_force_update (WnckScreen *screen)
   do_update_now (screen);
 }
 
+/**
+ * wnck_screen_force_update_workspaces:
+ * @screen: a #WnckScreen.
+ *
+ * Synchronously and immediately updates the #WnckWorkspace of @screen and
+ * the other state of @screen that does not depend on windows, like
+ * wnck_screen_force_update() does, but without reading any window. The list
+ * of #WnckWindow on @screen is still updated in the idle loop.
+ *
+ * This is meant for small applications that just need to inspect or
+ * modify workspaces and then exit: the cost of the update does not depend
+ * on the number of windows on @screen.
+ *
+ * Since: 3.4
+ **/
+void
+wnck_screen_force_update_workspaces (WnckScreen *screen)
+{
+  g_return_if_fail (WNCK_IS_SCREEN (screen));
+
+  do_update_workspaces_now (screen);
+}
+
+static gboolean
+window_list_contains (Window *list,
+                      int     length,
+                      Window  xwindow)
+{
+  int i;
+
+  for (i = 0; i < length; i++)
+    if (list[i] == xwindow)
+      return TRUE;
+
+  return FALSE;
+}
+
+static WnckWindow *
+materialize_window (WnckScreen *screen,
+                    Window      xwindow)
+{
+  WnckWindow *window;
+  WnckApplication *app;
+  WnckClassGroup *class_group;
+  const char *res_class;
+  Window leader;
+
+  window = wnck_window_get (xwindow);
+  if (window != NULL)
+    return window;
+
+  if (screen->priv->unlisted == NULL)
+    screen->priv->unlisted = g_hash_table_new (NULL, NULL);
+
+  window = _wnck_window_create (xwindow,
+                                screen,
+                                screen->priv->window_order++);
+  g_hash_table_insert (screen->priv->unlisted, window, window);
+
+  leader = wnck_window_get_group_leader (window);
+
+  app = wnck_application_get (leader);
+  if (app == NULL)
+    {
+      app = _wnck_application_create (leader, screen);
+      g_hash_table_insert (screen->priv->unlisted, app, app);
+    }
+
+  _wnck_application_add_window (app, window);
+
+  res_class = wnck_window_get_class_group_name (window);
+
+  class_group = wnck_class_group_get (res_class);
+  if (class_group == NULL)
+    {
+      class_group = _wnck_class_group_create (res_class);
+      g_hash_table_insert (screen->priv->unlisted, class_group, class_group);
+    }
+
+  _wnck_class_group_add_window (class_group, window);
+
+  return window;
+}
+
+/**
+ * wnck_screen_force_update_window:
+ * @screen: a #WnckScreen.
+ * @xwindow: an X window ID.
+ *
+ * Synchronously and immediately creates the #WnckWindow for @xwindow, its
+ * #WnckApplication and #WnckClassGroup, and the #WnckWindow it is transient
+ * for, if @xwindow is a window managed on @screen. The state of @screen that
+ * does not depend on windows is updated as by
+ * wnck_screen_force_update_workspaces(), and the active window is updated.
+ *
+ * Unlike wnck_screen_force_update(), no other window is read, so the cost of
+ * this does not depend on the number of windows on @screen. The windows
+ * created this way are not part of wnck_screen_get_windows() until the list
+ * of #WnckWindow on @screen is updated, at which point #WnckScreen::window-opened
+ * is emitted for them as usual.
+ *
+ * Return value: (transfer none): the #WnckWindow for @xwindow, or %NULL if
+ * @xwindow is not a window managed on @screen. The returned #WnckWindow is
+ * owned by libwnck and must not be referenced or unreferenced.
+ *
+ * Since: 3.4
+ **/
+WnckWindow *
+wnck_screen_force_update_window (WnckScreen *screen,
+                                 gulong      xwindow)
+{
+  WnckWindow *window;
+  WnckWindow *tmp;
+  Window *mapping;
+  int mapping_length;
+  int depth;
+
+  g_return_val_if_fail (WNCK_IS_SCREEN (screen), NULL);
+
+  do_update_workspaces_now (screen);
+
+  /* Only one property read, whatever the number of windows */
+  mapping = NULL;
+  mapping_length = 0;
+  _wnck_get_window_list (screen->priv->xscreen,
+                         screen->priv->xroot,
+                         _wnck_atom_get ("_NET_CLIENT_LIST"),
+                         &mapping,
+                         &mapping_length);
+
+  window = NULL;
+  if (window_list_contains (mapping, mapping_length, xwindow))
+    window = materialize_window (screen, xwindow);
+
+  /* The transient parents too, so that wnck_window_get_transient() works
+   * for the window; the depth limit protects against WM_TRANSIENT_FOR
+   * loops.
+   */
+  tmp = window;
+  for (depth = 0; tmp != NULL && depth < 16; depth++)
+    {
+      Window parent;
+
+      parent = _wnck_window_get_transient_for_xid (tmp);
+      if (parent == None ||
+          !window_list_contains (mapping, mapping_length, parent))
+        break;
+
+      tmp = materialize_window (screen, parent);
+    }
+
+  g_free (mapping);
+
+  if (window != NULL)
+    {
+      screen->priv->need_update_active_window = TRUE;
+      update_active_window (screen);
+    }
+
+  return window;
+}
+
 /**
  * wnck_screen_get_workspace_count:
  * @screen: a #WnckScreen.
@@ -1435,6 +1790,49 @@ arrays_contain_same_windows (Window *a,
   return result;
 }
 
+static void
+unlisted_windows_prune (WnckScreen *screen)
+{
+  GList *unlisted;
+  GList *tmp;
+
+  unlisted = g_hash_table_get_keys (screen->priv->unlisted);
+
+  for (tmp = unlisted; tmp; tmp = tmp->next)
+    {
+      WnckWindow *window;
+      WnckApplication *app;
+      WnckClassGroup *class_group;
+
+      if (!WNCK_IS_WINDOW (tmp->data))
+        continue;
+
+      window = WNCK_WINDOW (tmp->data);
+      g_hash_table_remove (screen->priv->unlisted, window);
+
+      app = wnck_window_get_application (window);
+      _wnck_application_remove_window (app, window);
+      if (wnck_application_get_windows (app) == NULL &&
+          g_hash_table_remove (screen->priv->unlisted, app))
+        _wnck_application_destroy (app);
+
+      class_group = wnck_window_get_class_group (window);
+      _wnck_class_group_remove_window (class_group, window);
+      if (wnck_class_group_get_windows (class_group) == NULL &&
+          g_hash_table_remove (screen->priv->unlisted, class_group))
+        _wnck_class_group_destroy (class_group);
+
+      if (window == screen->priv->active_window)
+        set_active_window (screen, NULL);
+      if (window == screen->priv->previously_active_window)
+        set_previously_active_window (screen, NULL);
+
+      _wnck_window_destroy (window);
+    }
+
+  g_list_free (unlisted);
+}
+
 static void
 update_client_list (WnckScreen *screen)
 {
@@ -1502,6 +1900,9 @@ update_client_list (WnckScreen *screen)
 
   new_hash = g_hash_table_new (NULL, NULL);
 
+  /* subscribe to all the new windows with a single flush */
+  _wnck_begin_request_batch ();
+
   new_list = NULL;
   i = 0;
   while (i < mapping_length)
@@ -1510,7 +1911,24 @@ update_client_list (WnckScreen *screen)
 
       window = wnck_window_get (mapping[i]);
 
-      if (window == NULL)
+      if (window != NULL && screen->priv->unlisted != NULL &&
+          g_hash_table_remove (screen->priv->unlisted, window))
+        {
+          /* created by wnck_screen_force_update_window(): announce it */
+          WnckApplication *app;
+	  WnckClassGroup *class_group;
+
+          created = g_list_prepend (created, window);
+
+          app = wnck_window_get_application (window);
+          if (g_hash_table_remove (screen->priv->unlisted, app))
+            created_apps = g_list_prepend (created_apps, app);
+
+          class_group = wnck_window_get_class_group (window);
+          if (g_hash_table_remove (screen->priv->unlisted, class_group))
+            created_class_groups = g_list_prepend (created_class_groups, class_group);
+        }
+      else if (window == NULL)
         {
           Window leader;
           WnckApplication *app;
@@ -1533,6 +1951,9 @@ update_client_list (WnckScreen *screen)
               app = _wnck_application_create (leader, screen);
               created_apps = g_list_prepend (created_apps, app);
             }
+          else if (screen->priv->unlisted != NULL &&
+                   g_hash_table_remove (screen->priv->unlisted, app))
+            created_apps = g_list_prepend (created_apps, app);
 
           _wnck_application_add_window (app, window);
 
@@ -1546,6 +1967,9 @@ update_client_list (WnckScreen *screen)
 	      class_group = _wnck_class_group_create (res_class);
 	      created_class_groups = g_list_prepend (created_class_groups, class_group);
 	    }
+          else if (screen->priv->unlisted != NULL &&
+                   g_hash_table_remove (screen->priv->unlisted, class_group))
+            created_class_groups = g_list_prepend (created_class_groups, class_group);
 
 	  _wnck_class_group_add_window (class_group, window);
         }
@@ -1557,6 +1981,8 @@ update_client_list (WnckScreen *screen)
       ++i;
     }
 
+  _wnck_end_request_batch (DisplayOfScreen (screen->priv->xscreen));
+
   /* put list back in order */
   new_list = g_list_reverse (new_list);
 
@@ -1597,6 +2023,11 @@ update_client_list (WnckScreen *screen)
 
   g_hash_table_destroy (new_hash);
 
+  /* Windows created by wnck_screen_force_update_window() that have been
+   * closed since then were never announced: drop them silently. */
+  if (screen->priv->unlisted != NULL)
+    unlisted_windows_prune (screen);
+
   /* Now get the mapping in list form */
   new_stack_list = NULL;
   i = 0;
@@ -1646,6 +2077,22 @@ update_client_list (WnckScreen *screen)
   screen->priv->mapped_windows = new_list;
   screen->priv->stacked_windows = new_stack_list;
 
+  for (tmp = created; tmp; tmp = tmp->next)
+    _wnck_window_set_listed (WNCK_WINDOW (tmp->data), TRUE);
+  for (tmp = closed; tmp; tmp = tmp->next)
+    _wnck_window_set_listed (WNCK_WINDOW (tmp->data), FALSE);
+
+  if (stack_changed)
+    {
+      int position;
+
+      position = 0;
+      for (tmp = new_stack_list; tmp; tmp = tmp->next)
+        _wnck_window_set_stack_position (WNCK_WINDOW (tmp->data), position++);
+
+      _wnck_screen_invalidate_transients (screen);
+    }
+
   /* Here we could get reentrancy if someone ran the main loop in
    * signal callbacks; though that would be a bit pathological, so we
    * don't handle it, but we do warn about it using reentrancy_guard
@@ -2235,14 +2682,32 @@ update_wm (WnckScreen *screen)
 }
 
 static void
-do_update_now (WnckScreen *screen)
+do_update_workspaces_now (WnckScreen *screen)
 {
-  if (screen->priv->update_handler)
+  /* Same as do_update_now(), minus the windows: the idle update stays
+   * queued for them */
+  if (screen->priv->need_update_workspace_list)
     {
-      g_source_remove (screen->priv->update_handler);
-      screen->priv->update_handler = 0;
+      screen->priv->need_update_viewport_settings = TRUE;
+      screen->priv->need_update_workspace_names = TRUE;
     }
 
+  update_workspace_list (screen);
+
+  update_active_workspace (screen);
+  update_viewport_settings (screen);
+  update_workspace_layout (screen);
+  update_workspace_names (screen);
+  update_showing_desktop (screen);
+  update_wm (screen);
+}
+
+static void
+do_update_now (WnckScreen *screen)
+{
+  /* the idle handler stays, if needed, for the windows */
+  screen->priv->update_queued = FALSE;
+
   /* if number of workspaces changes, we have to
    * update the per-workspace information as well
    * in case the WM changed the per-workspace info
@@ -2270,22 +2735,47 @@ do_update_now (WnckScreen *screen)
   update_bg_pixmap (screen);
 }
 
+/* All the pending updates of the screen and of its windows are done in one
+ * idle handler: first the screen, since it creates and destroys the
+ * windows, then the windows in the order they changed. */
 static gboolean
 update_idle (gpointer data)
 {
   WnckScreen *screen;
+  WnckWindow *window;
+  gint64 deadline;
 
   screen = data;
 
-  screen->priv->update_handler = 0;
+  if (screen->priv->update_queued)
+    do_update_now (screen);
 
-  do_update_now (screen);
+  deadline = 0;
+  if (screen->priv->update_budget > 0)
+    deadline = g_get_monotonic_time () + screen->priv->update_budget * 1000;
+
+  while ((window = g_queue_pop_head (screen->priv->dirty_windows)))
+    {
+      _wnck_window_process_queued_update (window);
+      g_object_unref (window);
+
+      /* leave the other windows for the next main loop iteration */
+      if (deadline != 0 && g_get_monotonic_time () >= deadline)
+        break;
+    }
+
+  /* signal handlers may have queued more updates */
+  if (screen->priv->update_queued ||
+      !g_queue_is_empty (screen->priv->dirty_windows))
+    return TRUE;
+
+  screen->priv->update_handler = 0;
 
   return FALSE;
 }
 
 static void
-queue_update (WnckScreen *screen)
+schedule_update (WnckScreen *screen)
 {
   if (screen->priv->update_handler != 0)
     return;
@@ -2293,9 +2783,23 @@ queue_update (WnckScreen *screen)
   screen->priv->update_handler = g_idle_add (update_idle, screen);
 }
 
+static void
+queue_update (WnckScreen *screen)
+{
+  screen->priv->update_queued = TRUE;
+  schedule_update (screen);
+}
+
 static void
 unqueue_update (WnckScreen *screen)
 {
+  WnckWindow *window;
+
+  screen->priv->update_queued = FALSE;
+
+  while ((window = g_queue_pop_head (screen->priv->dirty_windows)))
+    g_object_unref (window);
+
   if (screen->priv->update_handler != 0)
     {
       g_source_remove (screen->priv->update_handler);
@@ -2303,6 +2807,17 @@ unqueue_update (WnckScreen *screen)
     }
 }
 
+/* Called by queue_update() in window.c: window will be updated by the idle
+ * handler of the screen, unless its update is unqueued meanwhile. window.c
+ * makes sure a window is only in the queue once. */
+void
+_wnck_screen_queue_window_update (WnckScreen *screen,
+                                  WnckWindow *window)
+{
+  g_queue_push_tail (screen->priv->dirty_windows, g_object_ref (window));
+  schedule_update (screen);
+}
+
 static void
 emit_active_window_changed (WnckScreen *screen)
 {
@@ -2432,43 +2947,382 @@ emit_wm_changed (WnckScreen *screen)
                  0);
 }
 
-/**
- * wnck_screen_get_window_manager_name:
- * @screen: a #WnckScreen.
- *
- * Gets the name of the window manager.
- *
- * Return value: the name of the window manager, or %NULL if the window manager
- * does not comply with the <ulink
- * url="http://standards.freedesktop.org/wm-spec/wm-spec-latest.html">EWMH</ulink>
- * specification.
- *
- * Since: 2.20
- */
-const char *
-wnck_screen_get_window_manager_name (WnckScreen *screen)
+static void
+emit_changes_batched (WnckScreen *screen)
 {
-  g_return_val_if_fail (WNCK_IS_SCREEN (screen), NULL);
+  GArray *changes;
+  guint   i, n;
 
-  return screen->priv->wm_name;
+  changes = screen->priv->batched_changes;
+  if (changes == NULL || changes->len == 0)
+    return;
+
+  /* Handlers might trigger new changes: those go to the next batch. */
+  screen->priv->batched_changes = g_array_new (FALSE, FALSE,
+                                               sizeof (WnckWindowChange));
+  g_hash_table_remove_all (screen->priv->batched_changes_index);
+
+  /* Drop the entries of windows that were destroyed since they changed. */
+  n = 0;
+  for (i = 0; i < changes->len; i++)
+    {
+      if (g_array_index (changes, WnckWindowChange, i).window == NULL)
+        continue;
+
+      if (i != n)
+        g_array_index (changes, WnckWindowChange, n) =
+          g_array_index (changes, WnckWindowChange, i);
+      n++;
+    }
+
+  if (n > 0)
+    g_signal_emit (G_OBJECT (screen),
+                   signals[CHANGES_BATCHED],
+                   0, changes->data, n);
+
+  g_array_free (changes, TRUE);
 }
 
-/**
- * wnck_screen_net_wm_supports:
- * @screen: a #WnckScreen.
- * @atom: a property atom.
- *
- * Gets whether the window manager for @screen supports a certain hint from
- * the <ulink
- * url="http://standards.freedesktop.org/wm-spec/wm-spec-latest.html">Extended
- * Window Manager Hints specification</ulink> (EWMH).
- *
- * When using this function, keep in mind that the window manager can change
- * over time; so you should not use this function in a way that impacts
- * persistent application state. A common bug is that your application can
- * start up before the window manager does when the user logs in, and before
- * the window manager starts wnck_screen_net_wm_supports() will return %FALSE
- * for every property.
+static gboolean
+batch_idle (gpointer data)
+{
+  WnckScreen *screen;
+
+  screen = data;
+
+  screen->priv->batch_handler = 0;
+
+  emit_changes_batched (screen);
+
+  return FALSE;
+}
+
+static void
+unqueue_batch (WnckScreen *screen)
+{
+  if (screen->priv->batch_handler != 0)
+    {
+      g_source_remove (screen->priv->batch_handler);
+      screen->priv->batch_handler = 0;
+    }
+}
+
+void
+_wnck_screen_record_window_change (WnckScreen          *screen,
+                                   WnckWindow          *window,
+                                   WnckWindowChangeMask change,
+                                   gint64               handler_time)
+{
+  WnckWindowChange *entry;
+  guint             position;
+  gint              bit;
+
+  bit = g_bit_nth_lsf (change, -1);
+  g_assert (bit >= 0 && bit < N_WINDOW_CHANGES);
+
+  screen->priv->change_emissions[bit] += 1;
+  screen->priv->change_handler_time[bit] += MAX (handler_time, 0);
+
+  if (!screen->priv->batch_changes)
+    return;
+
+  position = GPOINTER_TO_UINT (g_hash_table_lookup (screen->priv->batched_changes_index,
+                                                    window));
+  if (position == 0)
+    {
+      WnckWindowChange new_entry;
+
+      new_entry.window = window;
+      new_entry.changes = 0;
+      g_array_append_val (screen->priv->batched_changes, new_entry);
+
+      position = screen->priv->batched_changes->len;
+      g_hash_table_insert (screen->priv->batched_changes_index,
+                           window, GUINT_TO_POINTER (position));
+    }
+
+  entry = &g_array_index (screen->priv->batched_changes,
+                          WnckWindowChange, position - 1);
+  entry->changes |= change;
+
+  if (screen->priv->batch_handler == 0)
+    screen->priv->batch_handler = g_idle_add (batch_idle, screen);
+}
+
+void
+_wnck_screen_forget_window_changes (WnckScreen *screen,
+                                    WnckWindow *window)
+{
+  WnckWindowChange *entry;
+  guint             position;
+
+  if (screen->priv->batched_changes_index == NULL)
+    return;
+
+  position = GPOINTER_TO_UINT (g_hash_table_lookup (screen->priv->batched_changes_index,
+                                                    window));
+  if (position == 0)
+    return;
+
+  entry = &g_array_index (screen->priv->batched_changes,
+                          WnckWindowChange, position - 1);
+  entry->window = NULL;
+  entry->changes = 0;
+
+  g_hash_table_remove (screen->priv->batched_changes_index, window);
+}
+
+/* Moves window from the transients of old_parent to the ones of new_parent;
+ * either can be None */
+void
+_wnck_screen_set_transient_for (WnckScreen *screen,
+                                WnckWindow *window,
+                                Window      old_parent,
+                                Window      new_parent)
+{
+  GList *transients;
+
+  if (old_parent == new_parent)
+    return;
+
+  if (old_parent != None)
+    {
+      transients = g_hash_table_lookup (screen->priv->transients, &old_parent);
+      transients = g_list_remove (transients, window);
+
+      if (transients)
+        g_hash_table_insert (screen->priv->transients,
+                             g_memdup (&old_parent, sizeof (Window)),
+                             transients);
+      else
+        g_hash_table_remove (screen->priv->transients, &old_parent);
+    }
+
+  if (new_parent != None)
+    {
+      transients = g_hash_table_lookup (screen->priv->transients, &new_parent);
+      transients = g_list_prepend (transients, window);
+
+      g_hash_table_insert (screen->priv->transients,
+                           g_memdup (&new_parent, sizeof (Window)),
+                           transients);
+    }
+
+  _wnck_screen_invalidate_transients (screen);
+}
+
+/* Returns the windows that are transient for xwindow, in no particular
+ * order; the list is owned by screen */
+GList*
+_wnck_screen_get_transients (WnckScreen *screen,
+                             Window      xwindow)
+{
+  return g_hash_table_lookup (screen->priv->transients, &xwindow);
+}
+
+void
+_wnck_screen_invalidate_transients (WnckScreen *screen)
+{
+  screen->priv->transients_serial++;
+  if (screen->priv->transients_serial == 0)
+    screen->priv->transients_serial = 1;
+}
+
+guint
+_wnck_screen_get_transients_serial (WnckScreen *screen)
+{
+  return screen->priv->transients_serial;
+}
+
+/* Assigns @window to the monitor containing its center, like
+ * gdk_screen_get_monitor_at_point() but without asking GDK in the usual
+ * case; the window emits WnckWindow::monitor-changed if that changes.
+ */
+void
+_wnck_screen_update_window_monitor (WnckScreen *screen,
+                                    WnckWindow *window)
+{
+  int x, y, width, height;
+  int i;
+
+  if (screen->priv->n_monitors == 0)
+    return;
+
+  wnck_window_get_geometry (window, &x, &y, &width, &height);
+  x += width / 2;
+  y += height / 2;
+
+  for (i = 0; i < screen->priv->n_monitors; i++)
+    {
+      GdkRectangle *monitor = &screen->priv->monitors[i];
+
+      if (x >= monitor->x && x < monitor->x + monitor->width &&
+          y >= monitor->y && y < monitor->y + monitor->height)
+        break;
+    }
+
+  /* off all monitors: GDK picks the closest one */
+  if (i == screen->priv->n_monitors)
+    i = gdk_screen_get_monitor_at_point (screen->priv->gdk_screen, x, y);
+
+  _wnck_window_set_monitor (window, i);
+}
+
+WnckWindowHot *
+_wnck_screen_alloc_window_hot (WnckScreen *screen)
+{
+  WnckWindowHot *hot;
+
+  if (screen->priv->free_window_hot == NULL)
+    {
+      WnckWindowHot *block;
+      int i;
+
+      block = g_new0 (WnckWindowHot, WINDOW_HOT_BLOCK_SIZE);
+      g_ptr_array_add (screen->priv->window_hot_blocks, block);
+
+      for (i = WINDOW_HOT_BLOCK_SIZE - 1; i >= 0; i--)
+        screen->priv->free_window_hot =
+          g_slist_prepend (screen->priv->free_window_hot, &block[i]);
+    }
+
+  hot = screen->priv->free_window_hot->data;
+  screen->priv->free_window_hot =
+    g_slist_delete_link (screen->priv->free_window_hot,
+                         screen->priv->free_window_hot);
+
+  return hot;
+}
+
+void
+_wnck_screen_free_window_hot (WnckScreen    *screen,
+                              WnckWindowHot *hot)
+{
+  memset (hot, 0, sizeof (WnckWindowHot));
+  screen->priv->free_window_hot =
+    g_slist_prepend (screen->priv->free_window_hot, hot);
+}
+
+/* Returns the windows of _NET_CLIENT_LIST whose record passes @filter, in
+ * no particular order. The windows that only exist because of
+ * wnck_screen_force_update_window() are skipped, like they are by
+ * wnck_screen_get_windows(). Unlike walking wnck_screen_get_windows() and
+ * calling the public getters, this streams through the blocks of records
+ * and only touches the windows that match.
+ */
+GList *
+_wnck_screen_filter_windows (WnckScreen          *screen,
+                             WnckWindowHotFilter  filter,
+                             gpointer             data)
+{
+  GList *result;
+  guint i;
+  int j;
+
+  result = NULL;
+
+  for (i = 0; i < screen->priv->window_hot_blocks->len; i++)
+    {
+      WnckWindowHot *block = g_ptr_array_index (screen->priv->window_hot_blocks, i);
+
+      for (j = 0; j < WINDOW_HOT_BLOCK_SIZE; j++)
+        if (block[j].window != NULL &&
+            block[j].listed &&
+            (* filter) (&block[j], data))
+          result = g_list_prepend (result, block[j].window);
+    }
+
+  return result;
+}
+
+static int
+compare_window_hot_stacking (gconstpointer a,
+                             gconstpointer b)
+{
+  const WnckWindowHot *hot_a = *(const WnckWindowHot **) a;
+  const WnckWindowHot *hot_b = *(const WnckWindowHot **) b;
+
+  return hot_a->stack_position - hot_b->stack_position;
+}
+
+/* Same as _wnck_screen_filter_windows(), but only for the stacked windows,
+ * from bottom to top like wnck_screen_get_windows_stacked().
+ */
+GList *
+_wnck_screen_filter_windows_stacked (WnckScreen          *screen,
+                                     WnckWindowHotFilter  filter,
+                                     gpointer             data)
+{
+  GPtrArray *matches;
+  GList *result;
+  guint i;
+  int j;
+
+  matches = g_ptr_array_new ();
+
+  for (i = 0; i < screen->priv->window_hot_blocks->len; i++)
+    {
+      WnckWindowHot *block = g_ptr_array_index (screen->priv->window_hot_blocks, i);
+
+      for (j = 0; j < WINDOW_HOT_BLOCK_SIZE; j++)
+        if (block[j].window != NULL &&
+            block[j].listed &&
+            block[j].stack_position >= 0 &&
+            (* filter) (&block[j], data))
+          g_ptr_array_add (matches, &block[j]);
+    }
+
+  g_ptr_array_sort (matches, compare_window_hot_stacking);
+
+  result = NULL;
+  for (i = matches->len; i > 0; i--)
+    {
+      WnckWindowHot *hot = g_ptr_array_index (matches, i - 1);
+      result = g_list_prepend (result, hot->window);
+    }
+
+  g_ptr_array_free (matches, TRUE);
+
+  return result;
+}
+
+/**
+ * wnck_screen_get_window_manager_name:
+ * @screen: a #WnckScreen.
+ *
+ * Gets the name of the window manager.
+ *
+ * Return value: the name of the window manager, or %NULL if the window manager
+ * does not comply with the <ulink
+ * url="http://standards.freedesktop.org/wm-spec/wm-spec-latest.html">EWMH</ulink>
+ * specification.
+ *
+ * Since: 2.20
+ */
+const char *
+wnck_screen_get_window_manager_name (WnckScreen *screen)
+{
+  g_return_val_if_fail (WNCK_IS_SCREEN (screen), NULL);
+
+  return screen->priv->wm_name;
+}
+
+/**
+ * wnck_screen_net_wm_supports:
+ * @screen: a #WnckScreen.
+ * @atom: a property atom.
+ *
+ * Gets whether the window manager for @screen supports a certain hint from
+ * the <ulink
+ * url="http://standards.freedesktop.org/wm-spec/wm-spec-latest.html">Extended
+ * Window Manager Hints specification</ulink> (EWMH).
+ *
+ * When using this function, keep in mind that the window manager can change
+ * over time; so you should not use this function in a way that impacts
+ * persistent application state. A common bug is that your application can
+ * start up before the window manager does when the user logs in, and before
+ * the window manager starts wnck_screen_net_wm_supports() will return %FALSE
+ * for every property.
  *
  * See also gdk_x11_screen_supports_net_wm_hint() in GDK.
  *
@@ -2764,6 +3618,589 @@ _wnck_screen_change_workspace_name (WnckScreen *screen,
   g_free (names);
 }
 
+/**
+ * wnck_screen_set_batch_changes:
+ * @screen: a #WnckScreen.
+ * @batch: whether to batch changes of #WnckWindow on @screen.
+ *
+ * Sets whether changes of #WnckWindow on @screen should be accumulated and
+ * emitted with #WnckScreen::changes-batched. This is useful for consumers
+ * tracking a lot of #WnckWindow, since they can then handle one batch of
+ * changes per main loop iteration instead of a signal per change. When
+ * batching is disabled, pending changes are emitted immediately.
+ *
+ * Since: 3.4
+ */
+void
+wnck_screen_set_batch_changes (WnckScreen *screen,
+                               gboolean    batch)
+{
+  g_return_if_fail (WNCK_IS_SCREEN (screen));
+
+  batch = batch != FALSE;
+
+  if (screen->priv->batch_changes == batch)
+    return;
+
+  if (batch)
+    {
+      screen->priv->batched_changes = g_array_new (FALSE, FALSE,
+                                                   sizeof (WnckWindowChange));
+      screen->priv->batched_changes_index = g_hash_table_new (NULL, NULL);
+      screen->priv->batch_changes = TRUE;
+    }
+  else
+    {
+      unqueue_batch (screen);
+      emit_changes_batched (screen);
+
+      /* A handler could have re-enabled batching. */
+      if (screen->priv->batch_changes == FALSE)
+        return;
+
+      screen->priv->batch_changes = FALSE;
+      unqueue_batch (screen);
+      g_array_free (screen->priv->batched_changes, TRUE);
+      screen->priv->batched_changes = NULL;
+      g_hash_table_destroy (screen->priv->batched_changes_index);
+      screen->priv->batched_changes_index = NULL;
+    }
+}
+
+/**
+ * wnck_screen_get_batch_changes:
+ * @screen: a #WnckScreen.
+ *
+ * Gets whether changes of #WnckWindow on @screen are batched. See
+ * wnck_screen_set_batch_changes().
+ *
+ * Return value: %TRUE if changes of #WnckWindow on @screen are batched, %FALSE
+ * otherwise.
+ *
+ * Since: 3.4
+ */
+gboolean
+wnck_screen_get_batch_changes (WnckScreen *screen)
+{
+  g_return_val_if_fail (WNCK_IS_SCREEN (screen), FALSE);
+
+  return screen->priv->batch_changes;
+}
+
+/**
+ * wnck_screen_set_update_budget:
+ * @screen: a #WnckScreen.
+ * @msecs: maximum time, in milliseconds, or 0 for no limit.
+ *
+ * Sets how long @screen can spend updating its #WnckWindow in one iteration
+ * of the main loop. Changes of windows are read in an idle handler; when
+ * many windows change at once, for example when the window manager is
+ * restarted, the remaining windows are updated in the next iterations of the
+ * main loop instead, so that the user interface stays responsive. By
+ * default, there is no limit.
+ *
+ * Since: 3.4
+ */
+void
+wnck_screen_set_update_budget (WnckScreen *screen,
+                               guint       msecs)
+{
+  g_return_if_fail (WNCK_IS_SCREEN (screen));
+
+  screen->priv->update_budget = msecs;
+}
+
+/**
+ * wnck_screen_get_update_budget:
+ * @screen: a #WnckScreen.
+ *
+ * Gets how long @screen can spend updating its #WnckWindow in one iteration
+ * of the main loop. See wnck_screen_set_update_budget().
+ *
+ * Return value: the maximum time, in milliseconds, or 0 if there is no limit.
+ *
+ * Since: 3.4
+ */
+guint
+wnck_screen_get_update_budget (WnckScreen *screen)
+{
+  g_return_val_if_fail (WNCK_IS_SCREEN (screen), 0);
+
+  return screen->priv->update_budget;
+}
+
+/**
+ * wnck_screen_get_change_statistics:
+ * @screen: a #WnckScreen.
+ * @change: a single value of #WnckWindowChangeMask.
+ * @n_emissions: (out) (allow-none): return location for the number of times
+ * the signal corresponding to @change was emitted by #WnckWindow of @screen.
+ * @handler_time: (out) (allow-none): return location for the total time, in
+ * microseconds, spent in the handlers of these emissions.
+ *
+ * Gets statistics about the emission of the per-window signals of
+ * #WnckWindow on @screen, since @screen was created or since the last call to
+ * wnck_screen_reset_change_statistics(). This can be used to find which
+ * signals are costly during storms of changes, like when a session is
+ * restored.
+ *
+ * Since: 3.4
+ */
+void
+wnck_screen_get_change_statistics (WnckScreen           *screen,
+                                   WnckWindowChangeMask  change,
+                                   guint                *n_emissions,
+                                   guint64              *handler_time)
+{
+  gint bit;
+
+  g_return_if_fail (WNCK_IS_SCREEN (screen));
+
+  bit = g_bit_nth_lsf (change, -1);
+  g_return_if_fail (bit >= 0 && bit < N_WINDOW_CHANGES);
+
+  if (n_emissions)
+    *n_emissions = screen->priv->change_emissions[bit];
+
+  if (handler_time)
+    *handler_time = screen->priv->change_handler_time[bit];
+}
+
+/**
+ * wnck_screen_reset_change_statistics:
+ * @screen: a #WnckScreen.
+ *
+ * Resets the statistics returned by wnck_screen_get_change_statistics().
+ *
+ * Since: 3.4
+ */
+void
+wnck_screen_reset_change_statistics (WnckScreen *screen)
+{
+  g_return_if_fail (WNCK_IS_SCREEN (screen));
+
+  memset (screen->priv->change_emissions, 0,
+          sizeof (screen->priv->change_emissions));
+  memset (screen->priv->change_handler_time, 0,
+          sizeof (screen->priv->change_handler_time));
+}
+
+typedef enum
+{
+  QUEUED_OPERATION,
+  QUEUED_MOVE_TO_WORKSPACE,
+  QUEUED_SET_GEOMETRY,
+  QUEUED_SET_WINDOW_TYPE
+} QueuedKind;
+
+typedef struct
+{
+  QueuedKind           kind;
+  WnckWindow          *window;
+  WnckWindowOperation  operation;
+  /* QUEUED_MOVE_TO_WORKSPACE */
+  WnckWorkspace       *space;
+  /* QUEUED_SET_GEOMETRY */
+  WnckWindowGravity         gravity;
+  WnckWindowMoveResizeMask  geometry_mask;
+  int                       x;
+  int                       y;
+  int                       width;
+  int                       height;
+  /* QUEUED_SET_WINDOW_TYPE */
+  WnckWindowType       wintype;
+} QueuedOperation;
+
+struct _WnckScreenOperations
+{
+  WnckScreen *screen;
+  GArray     *queued; /* of QueuedOperation */
+};
+
+/**
+ * wnck_screen_operations_new:
+ * @screen: a #WnckScreen.
+ *
+ * Creates a new empty list of operations on the windows of @screen.
+ * Operations are added to the list with wnck_screen_operations_add(),
+ * wnck_screen_operations_add_move_to_workspace(),
+ * wnck_screen_operations_add_set_geometry() and
+ * wnck_screen_operations_add_set_window_type(), and are all sent at once
+ * by wnck_screen_operations_commit(), with one timestamp and without waiting
+ * for the X server after each of them. This is much faster than calling the
+ * #WnckWindow functions one by one when acting on many windows.
+ *
+ * Return value: a new #WnckScreenOperations, to be freed with
+ * wnck_screen_operations_free().
+ *
+ * Since: 3.4
+ */
+WnckScreenOperations *
+wnck_screen_operations_new (WnckScreen *screen)
+{
+  WnckScreenOperations *operations;
+
+  g_return_val_if_fail (WNCK_IS_SCREEN (screen), NULL);
+
+  operations = g_slice_new (WnckScreenOperations);
+  operations->screen = screen;
+  operations->queued = g_array_new (FALSE, FALSE, sizeof (QueuedOperation));
+
+  return operations;
+}
+
+static void
+screen_operations_clear (WnckScreenOperations *operations)
+{
+  guint i;
+
+  for (i = 0; i < operations->queued->len; i++)
+    {
+      QueuedOperation *queued;
+
+      queued = &g_array_index (operations->queued, QueuedOperation, i);
+
+      g_object_unref (queued->window);
+      if (queued->space)
+        g_object_unref (queued->space);
+    }
+
+  g_array_set_size (operations->queued, 0);
+}
+
+/**
+ * wnck_screen_operations_free:
+ * @operations: a #WnckScreenOperations.
+ *
+ * Frees @operations. The operations that were not committed with
+ * wnck_screen_operations_commit() are discarded.
+ *
+ * Since: 3.4
+ */
+void
+wnck_screen_operations_free (WnckScreenOperations *operations)
+{
+  g_return_if_fail (operations != NULL);
+
+  screen_operations_clear (operations);
+  g_array_free (operations->queued, TRUE);
+
+  g_slice_free (WnckScreenOperations, operations);
+}
+
+/* Returns the new operation, valid until the next one is queued */
+static QueuedOperation *
+screen_operations_queue (WnckScreenOperations *operations,
+                         WnckWindow           *window,
+                         QueuedKind            kind)
+{
+  QueuedOperation queued;
+
+  memset (&queued, 0, sizeof (queued));
+  queued.kind = kind;
+  queued.window = g_object_ref (window);
+
+  g_array_append_val (operations->queued, queued);
+
+  return &g_array_index (operations->queued, QueuedOperation,
+                         operations->queued->len - 1);
+}
+
+/**
+ * wnck_screen_operations_add:
+ * @operations: a #WnckScreenOperations.
+ * @window: a #WnckWindow on the #WnckScreen of @operations.
+ * @operation: the operation to apply to @window.
+ *
+ * Queues @operation for @window in @operations. Nothing is sent until
+ * wnck_screen_operations_commit() is called, and operations are sent in the
+ * order they were added.
+ *
+ * Since: 3.4
+ */
+void
+wnck_screen_operations_add (WnckScreenOperations *operations,
+                            WnckWindow           *window,
+                            WnckWindowOperation   operation)
+{
+  QueuedOperation *queued;
+
+  g_return_if_fail (operations != NULL);
+  g_return_if_fail (WNCK_IS_WINDOW (window));
+  g_return_if_fail (wnck_window_get_screen (window) == operations->screen);
+  g_return_if_fail (operation >= WNCK_WINDOW_OPERATION_MINIMIZE &&
+                    operation <= WNCK_WINDOW_OPERATION_CLOSE);
+
+  queued = screen_operations_queue (operations, window, QUEUED_OPERATION);
+  queued->operation = operation;
+}
+
+/**
+ * wnck_screen_operations_add_move_to_workspace:
+ * @operations: a #WnckScreenOperations.
+ * @window: a #WnckWindow on the #WnckScreen of @operations.
+ * @space: a #WnckWorkspace.
+ *
+ * Queues a move of @window to @space in @operations, see
+ * wnck_window_move_to_workspace().
+ *
+ * Since: 3.4
+ */
+void
+wnck_screen_operations_add_move_to_workspace (WnckScreenOperations *operations,
+                                              WnckWindow           *window,
+                                              WnckWorkspace        *space)
+{
+  QueuedOperation *queued;
+
+  g_return_if_fail (operations != NULL);
+  g_return_if_fail (WNCK_IS_WINDOW (window));
+  g_return_if_fail (wnck_window_get_screen (window) == operations->screen);
+  g_return_if_fail (WNCK_IS_WORKSPACE (space));
+
+  queued = screen_operations_queue (operations, window,
+                                    QUEUED_MOVE_TO_WORKSPACE);
+  queued->space = g_object_ref (space);
+}
+
+/**
+ * wnck_screen_operations_add_set_geometry:
+ * @operations: a #WnckScreenOperations.
+ * @window: a #WnckWindow on the #WnckScreen of @operations.
+ * @gravity: the gravity point to use as a reference for the new position.
+ * @geometry_mask: a bitmask containing flags for what should be set.
+ * @x: new X coordinate in pixels of @window.
+ * @y: new Y coordinate in pixels of @window.
+ * @width: new width in pixels of @window.
+ * @height: new height in pixels of @window.
+ *
+ * Queues a change of the size and position of @window in @operations, see
+ * wnck_window_set_geometry(). The frame extents of @window are read when
+ * the operation is committed.
+ *
+ * Since: 3.4
+ */
+void
+wnck_screen_operations_add_set_geometry (WnckScreenOperations     *operations,
+                                         WnckWindow               *window,
+                                         WnckWindowGravity         gravity,
+                                         WnckWindowMoveResizeMask  geometry_mask,
+                                         int                       x,
+                                         int                       y,
+                                         int                       width,
+                                         int                       height)
+{
+  QueuedOperation *queued;
+
+  g_return_if_fail (operations != NULL);
+  g_return_if_fail (WNCK_IS_WINDOW (window));
+  g_return_if_fail (wnck_window_get_screen (window) == operations->screen);
+
+  queued = screen_operations_queue (operations, window, QUEUED_SET_GEOMETRY);
+  queued->gravity = gravity;
+  queued->geometry_mask = geometry_mask;
+  queued->x = x;
+  queued->y = y;
+  queued->width = width;
+  queued->height = height;
+}
+
+/**
+ * wnck_screen_operations_add_set_window_type:
+ * @operations: a #WnckScreenOperations.
+ * @window: a #WnckWindow on the #WnckScreen of @operations.
+ * @wintype: a semantic type.
+ *
+ * Queues a change of the semantic type of @window in @operations, see
+ * wnck_window_set_window_type().
+ *
+ * Since: 3.4
+ */
+void
+wnck_screen_operations_add_set_window_type (WnckScreenOperations *operations,
+                                            WnckWindow           *window,
+                                            WnckWindowType        wintype)
+{
+  QueuedOperation *queued;
+
+  g_return_if_fail (operations != NULL);
+  g_return_if_fail (WNCK_IS_WINDOW (window));
+  g_return_if_fail (wnck_window_get_screen (window) == operations->screen);
+
+  queued = screen_operations_queue (operations, window,
+                                    QUEUED_SET_WINDOW_TYPE);
+  queued->wintype = wintype;
+}
+
+/**
+ * wnck_screen_operations_commit:
+ * @operations: a #WnckScreenOperations.
+ * @timestamp: the X server timestamp of the user interaction event that
+ * caused these operations to occur.
+ *
+ * Sends all the operations queued in @operations, in order, and flushes
+ * them to the X server once. @timestamp is used for all the operations that
+ * need one. Errors, like a window that was closed in the meantime, are
+ * ignored. @operations is empty afterwards and can be reused.
+ *
+ * Since: 3.4
+ */
+void
+wnck_screen_operations_commit (WnckScreenOperations *operations,
+                               guint32               timestamp)
+{
+  guint i;
+
+  g_return_if_fail (operations != NULL);
+
+  if (operations->queued->len == 0)
+    return;
+
+  _wnck_begin_request_batch ();
+
+  for (i = 0; i < operations->queued->len; i++)
+    {
+      QueuedOperation *queued;
+      WnckWindow *window;
+
+      queued = &g_array_index (operations->queued, QueuedOperation, i);
+      window = queued->window;
+
+      switch (queued->kind)
+        {
+        case QUEUED_OPERATION:
+          break;
+        case QUEUED_MOVE_TO_WORKSPACE:
+          wnck_window_move_to_workspace (window, queued->space);
+          continue;
+        case QUEUED_SET_GEOMETRY:
+          wnck_window_set_geometry (window, queued->gravity,
+                                    queued->geometry_mask,
+                                    queued->x, queued->y,
+                                    queued->width, queued->height);
+          continue;
+        case QUEUED_SET_WINDOW_TYPE:
+          wnck_window_set_window_type (window, queued->wintype);
+          continue;
+        default:
+          g_assert_not_reached ();
+        }
+
+      switch (queued->operation)
+        {
+        case WNCK_WINDOW_OPERATION_MINIMIZE:
+          wnck_window_minimize (window);
+          break;
+        case WNCK_WINDOW_OPERATION_UNMINIMIZE:
+          wnck_window_unminimize (window, timestamp);
+          break;
+        case WNCK_WINDOW_OPERATION_MAXIMIZE:
+          wnck_window_maximize (window);
+          break;
+        case WNCK_WINDOW_OPERATION_UNMAXIMIZE:
+          wnck_window_unmaximize (window);
+          break;
+        case WNCK_WINDOW_OPERATION_MAXIMIZE_HORIZONTALLY:
+          wnck_window_maximize_horizontally (window);
+          break;
+        case WNCK_WINDOW_OPERATION_UNMAXIMIZE_HORIZONTALLY:
+          wnck_window_unmaximize_horizontally (window);
+          break;
+        case WNCK_WINDOW_OPERATION_MAXIMIZE_VERTICALLY:
+          wnck_window_maximize_vertically (window);
+          break;
+        case WNCK_WINDOW_OPERATION_UNMAXIMIZE_VERTICALLY:
+          wnck_window_unmaximize_vertically (window);
+          break;
+        case WNCK_WINDOW_OPERATION_MAKE_ABOVE:
+          wnck_window_make_above (window);
+          break;
+        case WNCK_WINDOW_OPERATION_UNMAKE_ABOVE:
+          wnck_window_unmake_above (window);
+          break;
+        case WNCK_WINDOW_OPERATION_MAKE_BELOW:
+          wnck_window_make_below (window);
+          break;
+        case WNCK_WINDOW_OPERATION_UNMAKE_BELOW:
+          wnck_window_unmake_below (window);
+          break;
+        case WNCK_WINDOW_OPERATION_SHADE:
+          wnck_window_shade (window);
+          break;
+        case WNCK_WINDOW_OPERATION_UNSHADE:
+          wnck_window_unshade (window);
+          break;
+        case WNCK_WINDOW_OPERATION_STICK:
+          wnck_window_stick (window);
+          break;
+        case WNCK_WINDOW_OPERATION_UNSTICK:
+          wnck_window_unstick (window);
+          break;
+        case WNCK_WINDOW_OPERATION_PIN:
+          wnck_window_pin (window);
+          break;
+        case WNCK_WINDOW_OPERATION_UNPIN:
+          wnck_window_unpin (window);
+          break;
+        case WNCK_WINDOW_OPERATION_FULLSCREEN:
+          wnck_window_set_fullscreen (window, TRUE);
+          break;
+        case WNCK_WINDOW_OPERATION_UNFULLSCREEN:
+          wnck_window_set_fullscreen (window, FALSE);
+          break;
+        case WNCK_WINDOW_OPERATION_SKIP_PAGER:
+          wnck_window_set_skip_pager (window, TRUE);
+          break;
+        case WNCK_WINDOW_OPERATION_UNSKIP_PAGER:
+          wnck_window_set_skip_pager (window, FALSE);
+          break;
+        case WNCK_WINDOW_OPERATION_SKIP_TASKLIST:
+          wnck_window_set_skip_tasklist (window, TRUE);
+          break;
+        case WNCK_WINDOW_OPERATION_UNSKIP_TASKLIST:
+          wnck_window_set_skip_tasklist (window, FALSE);
+          break;
+        case WNCK_WINDOW_OPERATION_ACTIVATE:
+          wnck_window_activate (window, timestamp);
+          break;
+        case WNCK_WINDOW_OPERATION_CLOSE:
+          wnck_window_close (window, timestamp);
+          break;
+        default:
+          g_assert_not_reached ();
+        }
+    }
+
+  _wnck_end_request_batch (DisplayOfScreen (operations->screen->priv->xscreen));
+
+  screen_operations_clear (operations);
+}
+
+void
+_wnck_screen_add_memory_usage (WnckMemoryUsage *usage)
+{
+  int i;
+  Display *display;
+
+  if (screens == NULL)
+    return;
+
+  display = _wnck_get_default_display ();
+
+  for (i = 0; i < ScreenCount (display); ++i)
+    {
+      if (screens[i] == NULL)
+        continue;
+
+      usage->n_screens++;
+
+      if (screens[i]->priv->update_handler != 0)
+        usage->n_pending_sources++;
+      if (screens[i]->priv->batch_handler != 0)
+        usage->n_pending_sources++;
+    }
+}
+
 void
 _wnck_screen_shutdown_all (void)
 {
@@ -51,6 +51,152 @@ typedef struct _WnckScreen        WnckScreen;
 typedef struct _WnckScreenClass   WnckScreenClass;
 typedef struct _WnckScreenPrivate WnckScreenPrivate;
 
+/**
+ * WnckWindowChangeMask:
+ * @WNCK_WINDOW_CHANGED_NAME: the name or icon name of the #WnckWindow changed
+ * (see #WnckWindow::name-changed).
+ * @WNCK_WINDOW_CHANGED_STATE: the state of the #WnckWindow changed (see
+ * #WnckWindow::state-changed).
+ * @WNCK_WINDOW_CHANGED_WORKSPACE: the #WnckWorkspace of the #WnckWindow
+ * changed (see #WnckWindow::workspace-changed).
+ * @WNCK_WINDOW_CHANGED_ICON: the icon of the #WnckWindow changed (see
+ * #WnckWindow::icon-changed).
+ * @WNCK_WINDOW_CHANGED_ACTIONS: the actions of the #WnckWindow changed (see
+ * #WnckWindow::actions-changed).
+ * @WNCK_WINDOW_CHANGED_GEOMETRY: the geometry of the #WnckWindow changed (see
+ * #WnckWindow::geometry-changed).
+ * @WNCK_WINDOW_CHANGED_MONITOR: the #WnckWindow moved to another monitor
+ * (see #WnckWindow::monitor-changed).
+ *
+ * Type used as a bitmask to describe what changed on a #WnckWindow in a
+ * #WnckWindowChange.
+ *
+ * Since: 3.4
+ */
+typedef enum
+{
+  WNCK_WINDOW_CHANGED_NAME      = 1 << 0,
+  WNCK_WINDOW_CHANGED_STATE     = 1 << 1,
+  WNCK_WINDOW_CHANGED_WORKSPACE = 1 << 2,
+  WNCK_WINDOW_CHANGED_ICON      = 1 << 3,
+  WNCK_WINDOW_CHANGED_ACTIONS   = 1 << 4,
+  WNCK_WINDOW_CHANGED_GEOMETRY  = 1 << 5,
+  WNCK_WINDOW_CHANGED_MONITOR   = 1 << 6
+} WnckWindowChangeMask;
+
+typedef struct _WnckWindowChange WnckWindowChange;
+
+/**
+ * WnckWindowChange:
+ * @window: the #WnckWindow that changed.
+ * @changes: bitmask of what changed on @window since the previous
+ * #WnckScreen::changes-batched emission.
+ *
+ * The #WnckWindowChange struct describes the accumulated changes on a
+ * #WnckWindow, as delivered by #WnckScreen::changes-batched.
+ *
+ * Since: 3.4
+ */
+struct _WnckWindowChange
+{
+  WnckWindow           *window;
+  WnckWindowChangeMask  changes;
+};
+
+/**
+ * WnckWindowOperation:
+ * @WNCK_WINDOW_OPERATION_MINIMIZE: minimize the window, see
+ * wnck_window_minimize().
+ * @WNCK_WINDOW_OPERATION_UNMINIMIZE: unminimize the window, see
+ * wnck_window_unminimize().
+ * @WNCK_WINDOW_OPERATION_MAXIMIZE: maximize the window, see
+ * wnck_window_maximize().
+ * @WNCK_WINDOW_OPERATION_UNMAXIMIZE: unmaximize the window, see
+ * wnck_window_unmaximize().
+ * @WNCK_WINDOW_OPERATION_MAXIMIZE_HORIZONTALLY: maximize the window
+ * horizontally, see wnck_window_maximize_horizontally().
+ * @WNCK_WINDOW_OPERATION_UNMAXIMIZE_HORIZONTALLY: unmaximize the window
+ * horizontally, see wnck_window_unmaximize_horizontally().
+ * @WNCK_WINDOW_OPERATION_MAXIMIZE_VERTICALLY: maximize the window
+ * vertically, see wnck_window_maximize_vertically().
+ * @WNCK_WINDOW_OPERATION_UNMAXIMIZE_VERTICALLY: unmaximize the window
+ * vertically, see wnck_window_unmaximize_vertically().
+ * @WNCK_WINDOW_OPERATION_MAKE_ABOVE: put the window on top of most windows,
+ * see wnck_window_make_above().
+ * @WNCK_WINDOW_OPERATION_UNMAKE_ABOVE: stop putting the window on top of
+ * most windows, see wnck_window_unmake_above().
+ * @WNCK_WINDOW_OPERATION_MAKE_BELOW: put the window below most windows, see
+ * wnck_window_make_below().
+ * @WNCK_WINDOW_OPERATION_UNMAKE_BELOW: stop putting the window below most
+ * windows, see wnck_window_unmake_below().
+ * @WNCK_WINDOW_OPERATION_SHADE: shade the window, see wnck_window_shade().
+ * @WNCK_WINDOW_OPERATION_UNSHADE: unshade the window, see
+ * wnck_window_unshade().
+ * @WNCK_WINDOW_OPERATION_STICK: stick the window, see wnck_window_stick().
+ * @WNCK_WINDOW_OPERATION_UNSTICK: unstick the window, see
+ * wnck_window_unstick().
+ * @WNCK_WINDOW_OPERATION_PIN: pin the window, see wnck_window_pin().
+ * @WNCK_WINDOW_OPERATION_UNPIN: unpin the window, see wnck_window_unpin().
+ * @WNCK_WINDOW_OPERATION_FULLSCREEN: make the window fullscreen, see
+ * wnck_window_set_fullscreen().
+ * @WNCK_WINDOW_OPERATION_UNFULLSCREEN: make the window quit fullscreen mode,
+ * see wnck_window_set_fullscreen().
+ * @WNCK_WINDOW_OPERATION_SKIP_PAGER: make the window not appear in pagers,
+ * see wnck_window_set_skip_pager().
+ * @WNCK_WINDOW_OPERATION_UNSKIP_PAGER: make the window appear in pagers, see
+ * wnck_window_set_skip_pager().
+ * @WNCK_WINDOW_OPERATION_SKIP_TASKLIST: make the window not appear in
+ * tasklists, see wnck_window_set_skip_tasklist().
+ * @WNCK_WINDOW_OPERATION_UNSKIP_TASKLIST: make the window appear in
+ * tasklists, see wnck_window_set_skip_tasklist().
+ * @WNCK_WINDOW_OPERATION_ACTIVATE: activate the window, see
+ * wnck_window_activate().
+ * @WNCK_WINDOW_OPERATION_CLOSE: close the window, see wnck_window_close().
+ *
+ * Type used to describe an operation queued on a #WnckScreenOperations.
+ *
+ * Since: 3.4
+ */
+typedef enum
+{
+  WNCK_WINDOW_OPERATION_MINIMIZE,
+  WNCK_WINDOW_OPERATION_UNMINIMIZE,
+  WNCK_WINDOW_OPERATION_MAXIMIZE,
+  WNCK_WINDOW_OPERATION_UNMAXIMIZE,
+  WNCK_WINDOW_OPERATION_MAXIMIZE_HORIZONTALLY,
+  WNCK_WINDOW_OPERATION_UNMAXIMIZE_HORIZONTALLY,
+  WNCK_WINDOW_OPERATION_MAXIMIZE_VERTICALLY,
+  WNCK_WINDOW_OPERATION_UNMAXIMIZE_VERTICALLY,
+  WNCK_WINDOW_OPERATION_MAKE_ABOVE,
+  WNCK_WINDOW_OPERATION_UNMAKE_ABOVE,
+  WNCK_WINDOW_OPERATION_MAKE_BELOW,
+  WNCK_WINDOW_OPERATION_UNMAKE_BELOW,
+  WNCK_WINDOW_OPERATION_SHADE,
+  WNCK_WINDOW_OPERATION_UNSHADE,
+  WNCK_WINDOW_OPERATION_STICK,
+  WNCK_WINDOW_OPERATION_UNSTICK,
+  WNCK_WINDOW_OPERATION_PIN,
+  WNCK_WINDOW_OPERATION_UNPIN,
+  WNCK_WINDOW_OPERATION_FULLSCREEN,
+  WNCK_WINDOW_OPERATION_UNFULLSCREEN,
+  WNCK_WINDOW_OPERATION_SKIP_PAGER,
+  WNCK_WINDOW_OPERATION_UNSKIP_PAGER,
+  WNCK_WINDOW_OPERATION_SKIP_TASKLIST,
+  WNCK_WINDOW_OPERATION_UNSKIP_TASKLIST,
+  WNCK_WINDOW_OPERATION_ACTIVATE,
+  WNCK_WINDOW_OPERATION_CLOSE
+} WnckWindowOperation;
+
+/**
+ * WnckScreenOperations:
+ *
+ * The #WnckScreenOperations struct contains only private fields and should
+ * not be directly accessed.
+ *
+ * Since: 3.4
+ */
+typedef struct _WnckScreenOperations WnckScreenOperations;
+
 /**
  * WnckScreen:
  *
@@ -113,8 +259,12 @@ struct _WnckScreenClass
   /* Window manager changed */
   void (* window_manager_changed)   (WnckScreen      *screen);
 
+  /* Batched window changes */
+  void (* changes_batched)          (WnckScreen             *screen,
+                                     const WnckWindowChange *changes,
+                                     guint                   n_changes);
+
   /* Padding for future expansion */
-  void (* pad2) (void);
   void (* pad3) (void);
   void (* pad4) (void);
   void (* pad5) (void);
@@ -208,6 +358,9 @@ WnckWindow*    wnck_screen_get_previously_active_window (WnckScreen *screen);
 GList*         wnck_screen_get_windows              (WnckScreen *screen);
 GList*         wnck_screen_get_windows_stacked      (WnckScreen *screen);
 void           wnck_screen_force_update             (WnckScreen *screen);
+void           wnck_screen_force_update_workspaces  (WnckScreen *screen);
+WnckWindow*    wnck_screen_force_update_window      (WnckScreen *screen,
+                                                     gulong      xwindow);
 int            wnck_screen_get_workspace_count      (WnckScreen *screen);
 void           wnck_screen_change_workspace_count   (WnckScreen *screen,
                                                      int         count);
@@ -223,6 +376,28 @@ void           wnck_screen_toggle_showing_desktop   (WnckScreen *screen,
 void           wnck_screen_move_viewport            (WnckScreen *screen,
                                                      int         x,
                                                      int         y);
+void           wnck_screen_set_batch_changes        (WnckScreen *screen,
+                                                     gboolean    batch);
+gboolean       wnck_screen_get_batch_changes        (WnckScreen *screen);
+void           wnck_screen_set_update_budget        (WnckScreen *screen,
+                                                     guint       msecs);
+guint          wnck_screen_get_update_budget        (WnckScreen *screen);
+void           wnck_screen_get_change_statistics    (WnckScreen           *screen,
+                                                     WnckWindowChangeMask  change,
+                                                     guint                *n_emissions,
+                                                     guint64              *handler_time);
+void           wnck_screen_reset_change_statistics  (WnckScreen *screen);
+
+WnckScreenOperations* wnck_screen_operations_new    (WnckScreen           *screen);
+void           wnck_screen_operations_free          (WnckScreenOperations *operations);
+void           wnck_screen_operations_add           (WnckScreenOperations *operations,
+                                                     WnckWindow           *window,
+                                                     WnckWindowOperation   operation);
+void           wnck_screen_operations_add_move_to_workspace (WnckScreenOperations *operations,
+                                                     WnckWindow           *window,
+                                                     WnckWorkspace        *space);
+void           wnck_screen_operations_commit        (WnckScreenOperations *operations,
+                                                     guint32               timestamp);
 void           _wnck_screen_get_workspace_layout     (WnckScreen             *screen,
                                                       _WnckLayoutOrientation *orientation,
                                                       int                    *rows,
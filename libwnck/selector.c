@@ -147,53 +147,16 @@ wnck_selector_get_default_window_icon (void)
   return retval;
 }
 
-static GdkPixbuf *
-wnck_selector_dimm_icon (GdkPixbuf *pixbuf)
-{
-  int x, y, pixel_stride, row_stride;
-  guchar *row, *pixels;
-  int w, h;
-  GdkPixbuf *dimmed;
-
-  w = gdk_pixbuf_get_width (pixbuf);
-  h = gdk_pixbuf_get_height (pixbuf);
-
-  if (gdk_pixbuf_get_has_alpha (pixbuf))
-    dimmed = gdk_pixbuf_copy (pixbuf);
-  else
-    dimmed = gdk_pixbuf_add_alpha (pixbuf, FALSE, 0, 0, 0);
-
-  pixel_stride = 4;
-
-  row = gdk_pixbuf_get_pixels (dimmed);
-  row_stride = gdk_pixbuf_get_rowstride (dimmed);
-
-  for (y = 0; y < h; y++)
-    {
-      pixels = row;
-      for (x = 0; x < w; x++)
-        {
-          pixels[3] /= 2;
-          pixels += pixel_stride;
-        }
-      row += row_stride;
-    }
-
-  return dimmed;
-}
-
 static void
 wnck_selector_set_window_icon (WnckSelector *selector,
                                GtkWidget *image,
                                WnckWindow *window, gboolean use_icon_size)
 {
-  GdkPixbuf *pixbuf, *freeme, *freeme2;
+  GdkPixbuf *pixbuf;
   int width, height;
   int icon_size = -1;
 
   pixbuf = NULL;
-  freeme = NULL;
-  freeme2 = NULL;
 
   if (window)
     pixbuf = wnck_window_get_mini_icon (window);
@@ -216,23 +179,17 @@ wnck_selector_set_window_icon (WnckSelector *selector,
 
       scale = ((double) icon_size) / MAX (width, height);
 
-      pixbuf = gdk_pixbuf_scale_simple (pixbuf, width * scale,
-                                        height * scale, GDK_INTERP_BILINEAR);
-      freeme = pixbuf;
+      width = width * scale;
+      height = height * scale;
     }
 
-  if (window && wnck_window_is_minimized (window))
-    {
-      pixbuf = wnck_selector_dimm_icon (pixbuf);
-      freeme2 = pixbuf;
-    }
+  /* Shares the scaled and dimmed variants with the tasklist */
+  pixbuf = _wnck_icon_get_variant (pixbuf, width, height,
+                                   window && wnck_window_is_minimized (window));
 
   gtk_image_set_from_pixbuf (GTK_IMAGE (image), pixbuf);
 
-  if (freeme)
-    g_object_unref (freeme);
-  if (freeme2)
-    g_object_unref (freeme2);
+  g_object_unref (pixbuf);
 }
 
 static void
@@ -1109,6 +1066,7 @@ wnck_selector_on_show (GtkWidget *widget, WnckSelector *selector)
   WnckScreen *screen;
   WnckWorkspace *workspace;
   int nb_workspace;
+  int active_workspace_num;
   int i;
   GList **windows_per_workspace;
   GList *windows;
@@ -1131,18 +1089,25 @@ wnck_selector_on_show (GtkWidget *widget, WnckSelector *selector)
   nb_workspace = wnck_screen_get_workspace_count (screen);
   windows_per_workspace = g_malloc0 (nb_workspace * sizeof (GList *));
 
-  /* Get windows ordered by workspaces */
+  /* Get windows ordered by workspaces; the workspace number is read from
+   * the record that the screen keeps for the scans over all windows */
+  workspace = wnck_screen_get_active_workspace (screen);
+  active_workspace_num = workspace ? wnck_workspace_get_number (workspace) : -1;
+
   windows = wnck_screen_get_windows (screen);
   windows = g_list_sort (windows, wnck_selector_windows_compare);
 
   for (l = windows; l; l = l->next)
     {
-      workspace = wnck_window_get_workspace (l->data);
-      if (!workspace && wnck_window_is_pinned (l->data))
-        workspace = wnck_screen_get_active_workspace (screen);
-      if (!workspace)
+      const WnckWindowHot *hot;
+
+      hot = _wnck_window_get_hot (l->data);
+      if (hot->workspace == ALL_WORKSPACES)
+        i = active_workspace_num;
+      else
+        i = hot->workspace;
+      if (i < 0 || i >= nb_workspace)
         continue;
-      i = wnck_workspace_get_number (workspace);
       windows_per_workspace[i] = g_list_prepend (windows_per_workspace[i],
                                                  l->data);
     }
@@ -126,45 +126,10 @@ wnck_tasklist_activate_next_in_class_group (WnckTask *task,
 
 
 
-static void
-wnck_dimm_icon (GdkPixbuf *pixbuf)
-{
-  int x, y, pixel_stride, row_stride;
-  guchar *row, *pixels;
-  int w, h;
-
-  g_assert (pixbuf != NULL);
-
-  w = gdk_pixbuf_get_width (pixbuf);
-  h = gdk_pixbuf_get_height (pixbuf);
-
-  g_assert (gdk_pixbuf_get_has_alpha (pixbuf));
-
-  pixel_stride = 4;
-
-  row = gdk_pixbuf_get_pixels (pixbuf);
-  row_stride = gdk_pixbuf_get_rowstride (pixbuf);
-
-  for (y = 0; y < h; y++)
-    {
-      pixels = row;
-
-      for (x = 0; x < w; x++)
-	{
-	  pixels[3] /= 2;
-
-	  pixels += pixel_stride;
-	}
-
-      row += row_stride;
-    }
-}
-
 static GdkPixbuf *
 wnck_task_scale_icon (GdkPixbuf *orig, gboolean minimized)
 {
   int w, h;
-  GdkPixbuf *pixbuf;
 
   if (!orig)
     return NULL;
@@ -172,43 +137,40 @@ wnck_task_scale_icon (GdkPixbuf *orig, gboolean minimized)
   w = gdk_pixbuf_get_width (orig);
   h = gdk_pixbuf_get_height (orig);
 
-  if (h != MINI_ICON_SIZE ||
-      !gdk_pixbuf_get_has_alpha (orig))
-    {
-      double scale;
-
-      pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB,
-			       TRUE,
-			       8,
-			       MINI_ICON_SIZE * w / (double) h,
-			       MINI_ICON_SIZE);
-
-      scale = MINI_ICON_SIZE / (double) gdk_pixbuf_get_height (orig);
-
-      gdk_pixbuf_scale (orig,
-			pixbuf,
-			0, 0,
-			gdk_pixbuf_get_width (pixbuf),
-			gdk_pixbuf_get_height (pixbuf),
-			0, 0,
-			scale, scale,
-			GDK_INTERP_HYPER);
-    }
-  else
-    pixbuf = orig;
+  if (h != MINI_ICON_SIZE)
+    w = MINI_ICON_SIZE * w / (double) h;
 
-  if (minimized)
-    {
-      if (orig == pixbuf)
-	pixbuf = gdk_pixbuf_copy (orig);
+  /* Variants are cached with the icon, so this is cheap on state changes */
+  return _wnck_icon_get_variant (orig, w, MINI_ICON_SIZE, minimized);
+}
 
-      wnck_dimm_icon (pixbuf);
-    }
+/* Applies operation to all the windows of a grouped task, sending the
+ * requests together instead of waiting for the X server after each one */
+static void
+wnck_task_apply_to_all (WnckTask            *task,
+                        WnckWindowOperation  operation)
+{
+  WnckScreenOperations *operations;
+  WnckTask *first;
+  GList *l;
 
-  if (orig == pixbuf)
-    g_object_ref (pixbuf);
+  if (task->windows == NULL)
+    return;
 
-  return pixbuf;
+  first = WNCK_TASK (task->windows->data);
+  operations = wnck_screen_operations_new (wnck_window_get_screen (first->window));
+
+  for (l = task->windows; l != NULL; l = l->next)
+    {
+      WnckTask *child = WNCK_TASK (l->data);
+      wnck_screen_operations_add (operations, child->window, operation);
+    }
+
+  /* This is inside an activate callback, so gtk_get_current_event_time()
+   * will work.
+   */
+  wnck_screen_operations_commit (operations, gtk_get_current_event_time ());
+  wnck_screen_operations_free (operations);
 }
 
 static void
@@ -216,15 +178,8 @@ wnck_task_maximize_all (GtkMenuItem *menu_item,
   		        gpointer     data)
 {
   WnckTask *task = WNCK_TASK (data);
-  GList *l;
 
-  l = task->windows;
-  while (l)
-    {
-      WnckTask *child = WNCK_TASK (l->data);
-      wnck_window_maximize (child->window);
-      l = l->next;
-    }
+  wnck_task_apply_to_all (task, WNCK_WINDOW_OPERATION_MAXIMIZE);
 }
 
 static void
@@ -232,15 +187,8 @@ wnck_task_unmaximize_all (GtkMenuItem *menu_item,
   		        gpointer     data)
 {
   WnckTask *task = WNCK_TASK (data);
-  GList *l;
 
-  l = task->windows;
-  while (l)
-    {
-      WnckTask *child = WNCK_TASK (l->data);
-      wnck_window_unmaximize (child->window);
-      l = l->next;
-    }
+  wnck_task_apply_to_all (task, WNCK_WINDOW_OPERATION_UNMAXIMIZE);
 }
 
 void
@@ -288,15 +236,8 @@ wnck_task_minimize_all (GtkMenuItem *menu_item,
   		        gpointer     data)
 {
   WnckTask *task = WNCK_TASK (data);
-  GList *l;
 
-  l = task->windows;
-  while (l)
-    {
-      WnckTask *child = WNCK_TASK (l->data);
-      wnck_window_minimize (child->window);
-      l = l->next;
-    }
+  wnck_task_apply_to_all (task, WNCK_WINDOW_OPERATION_MINIMIZE);
 }
 
 static void
@@ -304,15 +245,8 @@ wnck_task_close_all (GtkMenuItem *menu_item,
  		     gpointer     data)
 {
   WnckTask *task = WNCK_TASK (data);
-  GList *l;
 
-  l = task->windows;
-  while (l)
-    {
-      WnckTask *child = WNCK_TASK (l->data);
-      wnck_window_close (child->window, gtk_get_current_event_time ());
-      l = l->next;
-    }
+  wnck_task_apply_to_all (task, WNCK_WINDOW_OPERATION_CLOSE);
 }
 
 static void
@@ -320,18 +254,8 @@ wnck_task_unminimize_all (GtkMenuItem *menu_item,
 		          gpointer     data)
 {
   WnckTask *task = WNCK_TASK (data);
-  GList *l;
 
-  l = task->windows;
-  while (l)
-    {
-      WnckTask *child = WNCK_TASK (l->data);
-      /* This is inside an activate callback, so gtk_get_current_event_time()
-       * will work.
-       */
-      wnck_window_unminimize (child->window, gtk_get_current_event_time ());
-      l = l->next;
-    }
+  wnck_task_apply_to_all (task, WNCK_WINDOW_OPERATION_UNMINIMIZE);
 }
 
 
@@ -340,8 +264,8 @@ wnck_task_stop_glow (WnckTask *task)
 {
   /* We stop glowing, but we might still have the task colored,
    * so we don't reset the glow factor */
-  if (task->button_glow != 0)
-    g_source_remove (task->button_glow);
+  if (task->glowing)
+    wnck_tasklist_remove_glowing_task (task->tasklist, task);
 }
 
 static void
@@ -419,75 +343,55 @@ wnck_task_get_text (WnckTask *task,
   return NULL;
 }
 
-static gboolean
-wnck_task_button_glow (WnckTask *task)
+/* Called by the tasklist glow driver on each animation tick, with the
+ * fade style properties it caches. Returns FALSE once the task has
+ * reached its final color and can stop being animated.
+ */
+gboolean
+wnck_task_update_glow (WnckTask *task,
+                       gdouble   now,
+                       gfloat    fade_opacity,
+                       gfloat    loop_time,
+                       gint      fade_max_loops)
 {
-  GTimeVal tv;
-  gdouble now;
-  gfloat fade_opacity, loop_time;
-  gint fade_max_loops;
+  gdouble glow_factor;
   gboolean stopped;
 
-  g_get_current_time (&tv);
-  now = (tv.tv_sec * (1.0 * G_USEC_PER_SEC) +
-        tv.tv_usec) / G_USEC_PER_SEC;
-
   if (task->glow_start_time <= G_MINDOUBLE)
     task->glow_start_time = now;
 
-  gtk_widget_style_get (GTK_WIDGET (task->tasklist), "fade-opacity", &fade_opacity,
-                                                     "fade-loop-time", &loop_time,
-                                                     "fade-max-loops", &fade_max_loops,
-                                                     NULL);
+  glow_factor = fade_opacity * (0.5 -
+                                0.5 * cos ((now - task->glow_start_time) *
+                                           M_PI * 2.0 / loop_time));
 
-  if (task->button_glow == 0)
-    {
-      /* we're in "has stopped glowing" mode */
-      task->glow_factor = fade_opacity * 0.5;
-      stopped = TRUE;
-    }
+  if (now - task->start_needs_attention > loop_time * 1.0 * fade_max_loops)
+    stopped = ABS (glow_factor - fade_opacity * 0.5) < 0.05;
   else
-    {
-      task->glow_factor = fade_opacity * (0.5 -
-                                          0.5 * cos ((now - task->glow_start_time) *
-                                                     M_PI * 2.0 / loop_time));
-
-      if (now - task->start_needs_attention > loop_time * 1.0 * fade_max_loops)
-        stopped = ABS (task->glow_factor - fade_opacity * 0.5) < 0.05;
-      else
-        stopped = FALSE;
-    }
-
-  gtk_widget_queue_draw (task->button);
+    stopped = FALSE;
 
   if (stopped)
-    wnck_task_stop_glow (task);
+    glow_factor = fade_opacity * 0.5;
 
-  return !stopped;
-}
+  /* Ticks come at the frame rate; only repaint when the change is
+   * actually visible once blended. */
+  if (stopped || ABS (glow_factor - task->glow_factor) >= 1.0 / 255.0)
+    {
+      task->glow_factor = glow_factor;
+      gtk_widget_queue_draw (task->button);
+    }
 
-static void
-wnck_task_clear_glow_start_timeout_id (WnckTask *task)
-{
-  task->button_glow = 0;
+  return !stopped;
 }
 
 static void
 wnck_task_queue_glow (WnckTask *task)
 {
-  if (task->button_glow == 0)
+  if (!task->glowing)
     {
       task->glow_start_time = 0.0;
 
-      /* The animation doesn't speed up or slow down based on the
-       * timeout value, but instead will just appear smoother or
-       * choppier.
-       */
-      task->button_glow =
-        g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE,
-                            50,
-                            (GSourceFunc) wnck_task_button_glow, task,
-                            (GDestroyNotify) wnck_task_clear_glow_start_timeout_id);
+      /* The tasklist animates all glowing tasks from a single tick */
+      wnck_tasklist_add_glowing_task (task->tasklist, task);
     }
 }
 
@@ -1436,9 +1340,8 @@ wnck_task_draw (GtkWidget *widget,
   GtkStyleContext *context;
   GtkStateFlags state;
   GtkBorder padding;
-  GtkWidget    *tasklist_widget;
+  cairo_surface_t *background;
   gint width, height;
-  gboolean overlay_rect;
   gint arrow_width;
   gint arrow_height;
   GdkRGBA color;
@@ -1500,34 +1403,14 @@ wnck_task_draw (GtkWidget *widget,
   width = gtk_widget_get_allocated_width (task->button);
   height = gtk_widget_get_allocated_height (task->button);
 
-  tasklist_widget = GTK_WIDGET (task->tasklist);
-
-  context = gtk_widget_get_style_context (task->button);
-
-  /* first draw the button */
-  gtk_widget_style_get (tasklist_widget, "fade-overlay-rect", &overlay_rect, NULL);
-  if (overlay_rect)
+  /* first draw the button, rendered once per size by the tasklist */
+  background = wnck_tasklist_get_glow_background (task->tasklist, task->button,
+                                                  width, height);
+  if (background != NULL)
     {
-      GdkRGBA bg_color;
-
-      /* Draw a rectangle with selected background color */
-      gtk_style_context_get_background_color (context, GTK_STATE_FLAG_SELECTED, &bg_color);
-      gdk_cairo_set_source_rgba (cr, &bg_color);
+      cairo_set_source_surface (cr, background, 0, 0);
       cairo_paint (cr);
     }
-  else
-    {
-      gtk_style_context_save (context);
-      gtk_style_context_set_state (context, GTK_STATE_FLAG_SELECTED);
-      gtk_style_context_add_class (context, GTK_STYLE_CLASS_BUTTON);
-
-      cairo_save (cr);
-      gtk_render_background (context, cr, 0, 0, width, height);
-      gtk_render_frame (context, cr, 0, 0, width, height);
-      cairo_restore (cr);
-
-      gtk_style_context_restore (context);
-    }
 
   /* then the contents */
   gtk_container_propagate_draw (GTK_CONTAINER (task->button),
@@ -1650,7 +1533,7 @@ wnck_task_init (WnckTask *task) {
   task->glow_start_time = 0.0;
   task->glow_factor = 0.0;
 
-  task->button_glow = 0;
+  task->glowing = FALSE;
 
   task->row = 0;
   task->col = 0;
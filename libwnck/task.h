@@ -85,6 +85,7 @@ struct _WnckTask {
                               * to change the togglebutton state
                               */
   guint was_active : 1;      /* used to fixup activation behavior */
+  guint glowing : 1;         /* registered with the tasklist glow driver */
 
   guint button_activate;
 
@@ -94,8 +95,6 @@ struct _WnckTask {
   gdouble glow_start_time;
   gdouble glow_factor;
 
-  guint button_glow;
-
   guint row;
   guint col;
 };
@@ -132,6 +131,21 @@ WnckTask *wnck_task_new_from_startup_sequence (WnckTasklist      *tasklist,
                                                       SnStartupSequence *sequence);
 #endif
 void wnck_task_update_visible_state (WnckTask *task);
+gboolean wnck_task_update_glow (WnckTask *task,
+                                gdouble   now,
+                                gfloat    fade_opacity,
+                                gfloat    fade_loop_time,
+                                gint      fade_max_loops);
+
+/* Attention glow driver, implemented in tasklist.c */
+void             wnck_tasklist_add_glowing_task    (WnckTasklist *tasklist,
+                                                    WnckTask     *task);
+void             wnck_tasklist_remove_glowing_task (WnckTasklist *tasklist,
+                                                    WnckTask     *task);
+cairo_surface_t *wnck_tasklist_get_glow_background (WnckTasklist *tasklist,
+                                                    GtkWidget    *button,
+                                                    int           width,
+                                                    int           height);
 
 G_END_DECLS
 
@@ -88,12 +88,6 @@
 
 #define N_SCREEN_CONNECTIONS 5
 
-#define POINT_IN_RECT(xcoord, ycoord, rect) \
- ((xcoord) >= (rect).x &&                   \
-  (xcoord) <  ((rect).x + (rect).width) &&  \
-  (ycoord) >= (rect).y &&                   \
-  (ycoord) <  ((rect).y + (rect).height))
-
 typedef struct _skipped_window
 {
   WnckWindow *window;
@@ -128,6 +122,9 @@ struct _WnckTasklistPrivate
   gint max_button_width;
   gint max_button_height;
 
+  /* approximate char width of the font, -1 if it needs to be computed */
+  gint char_width;
+
   gboolean switch_workspace_on_unminimize;
 
   WnckTasklistGroupingType grouping;
@@ -138,6 +135,9 @@ struct _WnckTasklistPrivate
 
   guint idle_callback_tag;
 
+  /* publishes the icon geometries once the allocation settled */
+  guint icon_geometries_idle;
+
   int *size_hints;
   int size_hints_len;
 
@@ -147,16 +147,38 @@ struct _WnckTasklistPrivate
 
 #ifdef HAVE_STARTUP_NOTIFICATION
   SnMonitorContext *sn_context;
+  /* startup sequence tasks ordered by expiry time; the timeout is armed
+   * for the first one only */
+  GQueue *startup_deadlines;
   guint startup_sequence_timeout;
+  guint expiring_sequences : 1;
 #endif
 
   gint monitor_num;
-  GdkRectangle monitor_geometry;
   GtkReliefStyle relief;
 
   guint drag_start_time;
+
+  /* Tasks needing attention are animated together from one tick, which
+   * only runs while the tasklist is mapped.
+   */
+  GList *glowing_tasks;
+  guint glow_tick_id;
+
+  /* fade-* style properties, valid until the next style update */
+  gboolean fade_style_valid;
+  gfloat fade_opacity;
+  gfloat fade_loop_time;
+  gint fade_max_loops;
+  gboolean fade_overlay_rect;
+
+  /* "selected" button backgrounds, keyed by GLOW_BACKGROUND_KEY() */
+  GHashTable *glow_backgrounds;
 };
 
+#define GLOW_BACKGROUND_KEY(width, height) \
+  GUINT_TO_POINTER (((guint) (width) << 16) | ((guint) (height) & 0xffff))
+
 G_DEFINE_TYPE (WnckTasklist, wnck_tasklist, GTK_TYPE_CONTAINER);
 #define WNCK_TASKLIST_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), WNCK_TYPE_TASKLIST, WnckTasklistPrivate))
 
@@ -174,6 +196,12 @@ static void     wnck_tasklist_size_allocate (GtkWidget        *widget,
                                              GtkAllocation    *allocation);
 static void     wnck_tasklist_realize       (GtkWidget        *widget);
 static void     wnck_tasklist_unrealize     (GtkWidget        *widget);
+static void     wnck_tasklist_style_updated (GtkWidget        *widget);
+static void     wnck_tasklist_map           (GtkWidget        *widget);
+static void     wnck_tasklist_unmap         (GtkWidget        *widget);
+static void     wnck_tasklist_start_glow_tick (WnckTasklist   *tasklist);
+static void     wnck_tasklist_stop_glow_tick  (WnckTasklist   *tasklist);
+static void     wnck_tasklist_clear_glow_backgrounds (WnckTasklist *tasklist);
 static gboolean wnck_tasklist_scroll_event  (GtkWidget        *widget,
                                              GdkEventScroll   *event);
 static void     wnck_tasklist_forall        (GtkContainer     *container,
@@ -211,8 +239,8 @@ static void     wnck_tasklist_disconnect_window        (WnckTasklist *tasklist,
 
 static gboolean wnck_tasklist_change_active_timeout    (gpointer data);
 
-static void     wnck_tasklist_update_icon_geometries   (WnckTasklist *tasklist,
-							GList        *visible_tasks);
+static void     wnck_tasklist_queue_icon_geometries    (WnckTasklist *tasklist);
+static void     wnck_tasklist_unqueue_icon_geometries  (WnckTasklist *tasklist);
 static void     wnck_tasklist_connect_screen           (WnckTasklist *tasklist);
 static void     wnck_tasklist_disconnect_screen        (WnckTasklist *tasklist);
 
@@ -221,6 +249,9 @@ static void     wnck_tasklist_sn_event                 (SnMonitorEvent *event,
                                                         void           *user_data);
 static void     wnck_tasklist_check_end_sequence       (WnckTasklist   *tasklist,
                                                         WnckWindow     *window);
+static void     wnck_tasklist_schedule_sequence        (WnckTasklist   *tasklist,
+                                                        WnckTask       *task);
+static void     wnck_tasklist_arm_sequence_timeout     (WnckTasklist   *tasklist);
 #endif
 
 
@@ -265,6 +296,8 @@ wnck_tasklist_init (WnckTasklist *tasklist)
   tasklist->priv->max_button_width = 0;
   tasklist->priv->max_button_height = 0;
 
+  tasklist->priv->char_width = -1;
+
   tasklist->priv->switch_workspace_on_unminimize = FALSE;
 
   tasklist->priv->grouping = WNCK_TASKLIST_AUTO_GROUP;
@@ -276,6 +309,8 @@ wnck_tasklist_init (WnckTasklist *tasklist)
 
   tasklist->priv->idle_callback_tag = 0;
 
+  tasklist->priv->icon_geometries_idle = 0;
+
   tasklist->priv->size_hints = NULL;
   tasklist->priv->size_hints_len = 0;
 
@@ -285,13 +320,19 @@ wnck_tasklist_init (WnckTasklist *tasklist)
 
 #ifdef HAVE_STARTUP_NOTIFICATION
   tasklist->priv->sn_context = NULL;
+  tasklist->priv->startup_deadlines = g_queue_new ();
   tasklist->priv->startup_sequence_timeout = 0;
+  tasklist->priv->expiring_sequences = FALSE;
 #endif
 
   tasklist->priv->monitor_num = -1;
-  tasklist->priv->monitor_geometry.width = -1; /* invalid value */
   tasklist->priv->relief = GTK_RELIEF_NORMAL;
 
+  tasklist->priv->glowing_tasks = NULL;
+  tasklist->priv->glow_tick_id = 0;
+  tasklist->priv->fade_style_valid = FALSE;
+  tasklist->priv->glow_backgrounds = NULL;
+
   tasklist->priv->drag_start_time = 0;
 
   atk_obj = gtk_widget_get_accessible (widget);
@@ -315,6 +356,9 @@ wnck_tasklist_class_init (WnckTasklistClass *klass)
   widget_class->size_allocate = wnck_tasklist_size_allocate;
   widget_class->realize = wnck_tasklist_realize;
   widget_class->unrealize = wnck_tasklist_unrealize;
+  widget_class->style_updated = wnck_tasklist_style_updated;
+  widget_class->map = wnck_tasklist_map;
+  widget_class->unmap = wnck_tasklist_unmap;
   widget_class->scroll_event = wnck_tasklist_scroll_event;
 
   container_class->forall = wnck_tasklist_forall;
@@ -434,6 +478,11 @@ wnck_tasklist_finalize (GObject *object)
   g_hash_table_destroy (tasklist->priv->win_hash);
   tasklist->priv->win_hash = NULL;
 
+#ifdef HAVE_STARTUP_NOTIFICATION
+  g_queue_free (tasklist->priv->startup_deadlines);
+  tasklist->priv->startup_deadlines = NULL;
+#endif
+
   if (tasklist->priv->activate_timeout_id != 0)
     {
       g_source_remove (tasklist->priv->activate_timeout_id);
@@ -446,6 +495,8 @@ wnck_tasklist_finalize (GObject *object)
       tasklist->priv->idle_callback_tag = 0;
     }
 
+  wnck_tasklist_unqueue_icon_geometries (tasklist);
+
   g_free (tasklist->priv->size_hints);
   tasklist->priv->size_hints = NULL;
   tasklist->priv->size_hints_len = 0;
@@ -455,6 +506,12 @@ wnck_tasklist_finalize (GObject *object)
   tasklist->priv->free_icon_loader_data = NULL;
   tasklist->priv->icon_loader_data = NULL;
 
+  wnck_tasklist_stop_glow_tick (tasklist);
+  g_list_free (tasklist->priv->glowing_tasks);
+  tasklist->priv->glowing_tasks = NULL;
+
+  wnck_tasklist_clear_glow_backgrounds (tasklist);
+
   G_OBJECT_CLASS (wnck_tasklist_parent_class)->finalize (object);
 }
 
@@ -723,26 +780,35 @@ wnck_tasklist_score_groups (WnckTasklist *tasklist,
 
 
 static int
-wnck_tasklist_get_button_size (GtkWidget *widget)
+wnck_tasklist_get_button_size (WnckTasklist *tasklist)
 {
-  GtkStyleContext *style_context;
-  GtkStateFlags state;
-  PangoContext *context;
-  PangoFontMetrics *metrics;
-  gint char_width;
   gint text_width;
   gint width;
 
-  style_context = gtk_widget_get_style_context (widget);
-  state = gtk_widget_get_state_flags (widget);
+  /* Looking up the font metrics is expensive, and this is called for each
+   * size request: only do it again when the style changes.
+   */
+  if (tasklist->priv->char_width < 0)
+    {
+      GtkWidget *widget;
+      GtkStyleContext *style_context;
+      GtkStateFlags state;
+      PangoContext *context;
+      PangoFontMetrics *metrics;
+
+      widget = GTK_WIDGET (tasklist);
+      style_context = gtk_widget_get_style_context (widget);
+      state = gtk_widget_get_state_flags (widget);
+
+      context = gtk_widget_get_pango_context (widget);
+      metrics = pango_context_get_metrics (context,
+                                           gtk_style_context_get_font (style_context, state),
+                                           pango_context_get_language (context));
+      tasklist->priv->char_width = pango_font_metrics_get_approximate_char_width (metrics);
+      pango_font_metrics_unref (metrics);
+    }
 
-  context = gtk_widget_get_pango_context (widget);
-  metrics = pango_context_get_metrics (context,
-                                       gtk_style_context_get_font (style_context, state),
-                                       pango_context_get_language (context));
-  char_width = pango_font_metrics_get_approximate_char_width (metrics);
-  pango_font_metrics_unref (metrics);
-  text_width = PANGO_PIXELS (TASKLIST_TEXT_MAX_WIDTH * char_width);
+  text_width = PANGO_PIXELS (TASKLIST_TEXT_MAX_WIDTH * tasklist->priv->char_width);
 
   width = text_width + 2 * TASKLIST_BUTTON_PADDING
 	  + MINI_ICON_SIZE + 2 * TASKLIST_BUTTON_PADDING;
@@ -805,7 +871,7 @@ wnck_tasklist_size_request  (GtkWidget      *widget,
    * wouldn't work since our call to gtk_widget_size_request() does not take
    * into account the hidden widgets.
    */
-  tasklist->priv->max_button_width = wnck_tasklist_get_button_size (widget);
+  tasklist->priv->max_button_width = wnck_tasklist_get_button_size (tasklist);
   tasklist->priv->max_button_height = max_height;
 
   gtk_widget_get_allocation (GTK_WIDGET (tasklist), &tasklist_allocation);
@@ -1131,8 +1197,8 @@ wnck_tasklist_size_allocate (GtkWidget      *widget,
       l = l->next;
     }
 
-  /* Update icon geometries. */
-  wnck_tasklist_update_icon_geometries (tasklist, visible_tasks);
+  /* Update icon geometries, once the whole layout is done */
+  wnck_tasklist_queue_icon_geometries (tasklist);
 
   g_list_free (visible_tasks);
   g_list_free (tasklist->priv->windows);
@@ -1143,6 +1209,36 @@ wnck_tasklist_size_allocate (GtkWidget      *widget,
                                                                 allocation);
 }
 
+void
+_wnck_tasklist_add_memory_usage (WnckMemoryUsage *usage)
+{
+  GSList *l;
+
+  for (l = tasklist_instances; l != NULL; l = l->next)
+    {
+      WnckTasklist *tasklist = WNCK_TASKLIST (l->data);
+
+      usage->n_tasklists++;
+      usage->n_tasklist_buttons +=
+        g_hash_table_size (tasklist->priv->win_hash) +
+        g_hash_table_size (tasklist->priv->class_group_hash) +
+        g_list_length (tasklist->priv->startup_sequences);
+
+      if (tasklist->priv->idle_callback_tag != 0)
+        usage->n_pending_sources++;
+      if (tasklist->priv->icon_geometries_idle != 0)
+        usage->n_pending_sources++;
+      if (tasklist->priv->activate_timeout_id != 0)
+        usage->n_pending_sources++;
+      if (tasklist->priv->glow_tick_id != 0)
+        usage->n_tick_callbacks++;
+#ifdef HAVE_STARTUP_NOTIFICATION
+      if (tasklist->priv->startup_sequence_timeout != 0)
+        usage->n_pending_sources++;
+#endif
+    }
+}
+
 static void
 wnck_tasklist_realize (GtkWidget *widget)
 {
@@ -1186,11 +1282,15 @@ wnck_tasklist_unrealize (GtkWidget *widget)
   wnck_tasklist_disconnect_screen (tasklist);
   tasklist->priv->screen = NULL;
 
+  wnck_tasklist_unqueue_icon_geometries (tasklist);
+
 #ifdef HAVE_STARTUP_NOTIFICATION
   sn_monitor_context_unref (tasklist->priv->sn_context);
   tasklist->priv->sn_context = NULL;
 #endif
 
+  wnck_tasklist_clear_glow_backgrounds (tasklist);
+
   (* GTK_WIDGET_CLASS (wnck_tasklist_parent_class)->unrealize) (widget);
 
   tasklist_instances = g_slist_remove (tasklist_instances, tasklist);
@@ -1199,6 +1299,265 @@ wnck_tasklist_unrealize (GtkWidget *widget)
 		   NULL);
 }
 
+static void
+wnck_tasklist_style_updated (GtkWidget *widget)
+{
+  WnckTasklist *tasklist;
+
+  tasklist = WNCK_TASKLIST (widget);
+
+  tasklist->priv->char_width = -1;
+  tasklist->priv->fade_style_valid = FALSE;
+  wnck_tasklist_clear_glow_backgrounds (tasklist);
+
+  (* GTK_WIDGET_CLASS (wnck_tasklist_parent_class)->style_updated) (widget);
+}
+
+static void
+wnck_tasklist_map (GtkWidget *widget)
+{
+  WnckTasklist *tasklist;
+
+  tasklist = WNCK_TASKLIST (widget);
+
+  (* GTK_WIDGET_CLASS (wnck_tasklist_parent_class)->map) (widget);
+
+  if (tasklist->priv->glowing_tasks != NULL)
+    wnck_tasklist_start_glow_tick (tasklist);
+}
+
+static void
+wnck_tasklist_unmap (GtkWidget *widget)
+{
+  WnckTasklist *tasklist;
+
+  tasklist = WNCK_TASKLIST (widget);
+
+  /* Nobody can see the glow: don't wake up for it. The animation is
+   * driven by the wall clock, so it resumes in phase when remapped. */
+  wnck_tasklist_stop_glow_tick (tasklist);
+
+  (* GTK_WIDGET_CLASS (wnck_tasklist_parent_class)->unmap) (widget);
+}
+
+static void
+wnck_tasklist_ensure_fade_style (WnckTasklist *tasklist)
+{
+  if (tasklist->priv->fade_style_valid)
+    return;
+
+  gtk_widget_style_get (GTK_WIDGET (tasklist),
+                        "fade-opacity", &tasklist->priv->fade_opacity,
+                        "fade-loop-time", &tasklist->priv->fade_loop_time,
+                        "fade-max-loops", &tasklist->priv->fade_max_loops,
+                        "fade-overlay-rect", &tasklist->priv->fade_overlay_rect,
+                        NULL);
+
+  tasklist->priv->fade_style_valid = TRUE;
+}
+
+/* Advances the glow of every task needing attention. Returns FALSE when
+ * none of them needs animating anymore.
+ */
+static gboolean
+wnck_tasklist_glow_step (WnckTasklist *tasklist)
+{
+  GTimeVal tv;
+  gdouble now;
+  GList *l;
+
+  /* start_needs_attention is a wall clock time, so the animation is too */
+  g_get_current_time (&tv);
+  now = (tv.tv_sec * (1.0 * G_USEC_PER_SEC) +
+        tv.tv_usec) / G_USEC_PER_SEC;
+
+  wnck_tasklist_ensure_fade_style (tasklist);
+
+  l = tasklist->priv->glowing_tasks;
+  while (l != NULL)
+    {
+      WnckTask *task = WNCK_TASK (l->data);
+      GList *next = l->next;
+
+      if (!wnck_task_update_glow (task, now,
+                                  tasklist->priv->fade_opacity,
+                                  tasklist->priv->fade_loop_time,
+                                  tasklist->priv->fade_max_loops))
+        {
+          task->glowing = FALSE;
+          tasklist->priv->glowing_tasks =
+            g_list_delete_link (tasklist->priv->glowing_tasks, l);
+        }
+
+      l = next;
+    }
+
+  if (tasklist->priv->glowing_tasks == NULL)
+    {
+      tasklist->priv->glow_tick_id = 0;
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+#if GTK_CHECK_VERSION (3, 8, 0)
+static gboolean
+wnck_tasklist_glow_tick (GtkWidget     *widget,
+                         GdkFrameClock *frame_clock,
+                         gpointer       data)
+{
+  return wnck_tasklist_glow_step (WNCK_TASKLIST (widget));
+}
+#else
+static gboolean
+wnck_tasklist_glow_timeout (gpointer data)
+{
+  return wnck_tasklist_glow_step (WNCK_TASKLIST (data));
+}
+#endif
+
+static void
+wnck_tasklist_start_glow_tick (WnckTasklist *tasklist)
+{
+  if (tasklist->priv->glow_tick_id != 0 ||
+      !gtk_widget_get_mapped (GTK_WIDGET (tasklist)))
+    return;
+
+#if GTK_CHECK_VERSION (3, 8, 0)
+  tasklist->priv->glow_tick_id =
+    gtk_widget_add_tick_callback (GTK_WIDGET (tasklist),
+                                  wnck_tasklist_glow_tick,
+                                  NULL, NULL);
+#else
+  /* The animation doesn't speed up or slow down based on the
+   * timeout value, but instead will just appear smoother or
+   * choppier.
+   */
+  tasklist->priv->glow_tick_id =
+    g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE, 50,
+                        wnck_tasklist_glow_timeout, tasklist, NULL);
+#endif
+}
+
+static void
+wnck_tasklist_stop_glow_tick (WnckTasklist *tasklist)
+{
+  if (tasklist->priv->glow_tick_id == 0)
+    return;
+
+#if GTK_CHECK_VERSION (3, 8, 0)
+  gtk_widget_remove_tick_callback (GTK_WIDGET (tasklist),
+                                   tasklist->priv->glow_tick_id);
+#else
+  g_source_remove (tasklist->priv->glow_tick_id);
+#endif
+  tasklist->priv->glow_tick_id = 0;
+}
+
+void
+wnck_tasklist_add_glowing_task (WnckTasklist *tasklist,
+                                WnckTask     *task)
+{
+  if (task->glowing)
+    return;
+
+  task->glowing = TRUE;
+  tasklist->priv->glowing_tasks =
+    g_list_prepend (tasklist->priv->glowing_tasks, task);
+
+  wnck_tasklist_start_glow_tick (tasklist);
+}
+
+void
+wnck_tasklist_remove_glowing_task (WnckTasklist *tasklist,
+                                   WnckTask     *task)
+{
+  if (!task->glowing)
+    return;
+
+  task->glowing = FALSE;
+  tasklist->priv->glowing_tasks =
+    g_list_remove (tasklist->priv->glowing_tasks, task);
+
+  if (tasklist->priv->glowing_tasks == NULL)
+    wnck_tasklist_stop_glow_tick (tasklist);
+}
+
+static void
+wnck_tasklist_clear_glow_backgrounds (WnckTasklist *tasklist)
+{
+  if (tasklist->priv->glow_backgrounds != NULL)
+    {
+      g_hash_table_destroy (tasklist->priv->glow_backgrounds);
+      tasklist->priv->glow_backgrounds = NULL;
+    }
+}
+
+/* Returns the "selected" background glowing buttons blend in, rendered
+ * once per button size and owned by the tasklist.
+ */
+cairo_surface_t *
+wnck_tasklist_get_glow_background (WnckTasklist *tasklist,
+                                   GtkWidget    *button,
+                                   int           width,
+                                   int           height)
+{
+  GtkStyleContext *context;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  if (width <= 0 || height <= 0 || !gtk_widget_get_realized (button))
+    return NULL;
+
+  if (tasklist->priv->glow_backgrounds == NULL)
+    tasklist->priv->glow_backgrounds =
+      g_hash_table_new_full (NULL, NULL, NULL,
+                             (GDestroyNotify) cairo_surface_destroy);
+
+  surface = g_hash_table_lookup (tasklist->priv->glow_backgrounds,
+                                 GLOW_BACKGROUND_KEY (width, height));
+  if (surface != NULL)
+    return surface;
+
+  wnck_tasklist_ensure_fade_style (tasklist);
+
+  surface = gdk_window_create_similar_surface (gtk_widget_get_window (button),
+                                               CAIRO_CONTENT_COLOR_ALPHA,
+                                               width, height);
+  cr = cairo_create (surface);
+
+  context = gtk_widget_get_style_context (button);
+
+  if (tasklist->priv->fade_overlay_rect)
+    {
+      GdkRGBA bg_color;
+
+      /* Draw a rectangle with selected background color */
+      gtk_style_context_get_background_color (context, GTK_STATE_FLAG_SELECTED, &bg_color);
+      gdk_cairo_set_source_rgba (cr, &bg_color);
+      cairo_paint (cr);
+    }
+  else
+    {
+      gtk_style_context_save (context);
+      gtk_style_context_set_state (context, GTK_STATE_FLAG_SELECTED);
+      gtk_style_context_add_class (context, GTK_STYLE_CLASS_BUTTON);
+
+      gtk_render_background (context, cr, 0, 0, width, height);
+      gtk_render_frame (context, cr, 0, 0, width, height);
+
+      gtk_style_context_restore (context);
+    }
+
+  cairo_destroy (cr);
+
+  g_hash_table_insert (tasklist->priv->glow_backgrounds,
+                       GLOW_BACKGROUND_KEY (width, height), surface);
+
+  return surface;
+}
+
 static void
 wnck_tasklist_forall (GtkContainer *container,
                       gboolean      include_internals,
@@ -1318,6 +1677,9 @@ wnck_tasklist_remove (GtkContainer   *container,
 	  tasklist->priv->startup_sequences =
 	    g_list_remove (tasklist->priv->startup_sequences,
 			   task);
+#ifdef HAVE_STARTUP_NOTIFICATION
+          g_queue_remove (tasklist->priv->startup_deadlines, task);
+#endif
 
           gtk_widget_unparent (widget);
           g_object_unref (task);
@@ -1325,6 +1687,12 @@ wnck_tasklist_remove (GtkContainer   *container,
 	}
     }
 
+#ifdef HAVE_STARTUP_NOTIFICATION
+  /* sequence_timeout_callback() resizes once for all the expired ones */
+  if (tasklist->priv->expiring_sequences)
+    return;
+#endif
+
   gtk_widget_queue_resize (GTK_WIDGET (container));
 }
 
@@ -1598,29 +1966,48 @@ wnck_tasklist_free_tasks (WnckTasklist *tasklist)
 }
 
 
+typedef struct
+{
+  WnckTasklist  *tasklist;
+  WnckWorkspace *active_workspace;
+  int            active_workspace_num;
+  /* windows that only belong to the skipped list */
+  GList         *skipped;
+} TasklistFilter;
+
+static void
+tasklist_filter_init (TasklistFilter *filter,
+                      WnckTasklist   *tasklist)
+{
+  filter->tasklist = tasklist;
+  filter->active_workspace =
+                 wnck_screen_get_active_workspace (tasklist->priv->screen);
+  filter->active_workspace_num = filter->active_workspace ?
+                 wnck_workspace_get_number (filter->active_workspace) : -1;
+  filter->skipped = NULL;
+}
+
 /*
- * This function determines if a window should be included in the tasklist.
+ * This function determines if a window should be included in the tasklist,
+ * from the record of the window that the screen scans.
  */
 static gboolean
-tasklist_include_window_impl (WnckTasklist *tasklist,
-                              WnckWindow   *win,
-                              gboolean      check_for_skipped_list)
+tasklist_include_window_impl (const WnckWindowHot *hot,
+                              TasklistFilter      *filter,
+                              gboolean             check_for_skipped_list)
 {
-  WnckWorkspace *active_workspace;
-  int x, y, w, h;
+  WnckTasklist *tasklist;
 
-  if (!check_for_skipped_list &&
-      wnck_window_get_state (win) & WNCK_WINDOW_STATE_SKIP_TASKLIST)
+  tasklist = filter->tasklist;
+
+  if (!check_for_skipped_list && hot->skip_taskbar)
     return FALSE;
 
-  if (tasklist->priv->monitor_num != -1)
-    {
-      wnck_window_get_geometry (win, &x, &y, &w, &h);
-      /* Don't include the window if its center point is not on the same monitor */
-      if (gdk_screen_get_monitor_at_point (_wnck_screen_get_gdk_screen (tasklist->priv->screen),
-                                           x + w / 2, y + h / 2) != tasklist->priv->monitor_num)
-        return FALSE;
-    }
+  /* Don't include the window if its center point is not on the same
+   * monitor; the screen keeps track of that for all the tasklists */
+  if (tasklist->priv->monitor_num != -1 &&
+      hot->monitor != tasklist->priv->monitor_num)
+    return FALSE;
 
   /* Remainder of checks aren't relevant for checking if the window should
    * be in the skipped list.
@@ -1631,38 +2018,51 @@ tasklist_include_window_impl (WnckTasklist *tasklist,
   if (tasklist->priv->include_all_workspaces)
     return TRUE;
 
-  if (wnck_window_is_pinned (win))
+  if (hot->workspace == ALL_WORKSPACES)
     return TRUE;
 
-  active_workspace = wnck_screen_get_active_workspace (tasklist->priv->screen);
-  if (active_workspace == NULL)
+  if (filter->active_workspace == NULL)
     return TRUE;
 
-  if (wnck_window_or_transient_needs_attention (win))
+  if (wnck_window_or_transient_needs_attention (hot->window))
     return TRUE;
 
-  if (active_workspace != wnck_window_get_workspace (win))
+  if (hot->workspace != filter->active_workspace_num)
     return FALSE;
 
-  if (!wnck_workspace_is_virtual (active_workspace))
+  if (!wnck_workspace_is_virtual (filter->active_workspace))
     return TRUE;
 
-  return wnck_window_is_in_viewport (win, active_workspace);
+  return wnck_window_is_in_viewport (hot->window, filter->active_workspace);
 }
 
+/* Selects the windows of the tasklist, and collects the windows of the
+ * skipped list in the same scan.
+ */
 static gboolean
-tasklist_include_in_skipped_list (WnckTasklist *tasklist, WnckWindow *win)
+tasklist_window_hot_filter (const WnckWindowHot *hot,
+                            gpointer             data)
 {
-  return tasklist_include_window_impl (tasklist,
-                                       win,
-                                       TRUE /* check_for_skipped_list */);
+  TasklistFilter *filter = data;
+
+  if (tasklist_include_window_impl (hot, filter, FALSE))
+    return TRUE;
+
+  if (tasklist_include_window_impl (hot, filter, TRUE))
+    filter->skipped = g_list_prepend (filter->skipped, hot->window);
+
+  return FALSE;
 }
 
 static gboolean
 wnck_tasklist_include_window (WnckTasklist *tasklist, WnckWindow *win)
 {
-  return tasklist_include_window_impl (tasklist,
-                                       win,
+  TasklistFilter filter;
+
+  tasklist_filter_init (&filter, tasklist);
+
+  return tasklist_include_window_impl (_wnck_window_get_hot (win),
+                                       &filter,
                                        FALSE /* check_for_skipped_list */);
 }
 
@@ -1670,6 +2070,7 @@ void
 wnck_tasklist_update_lists (WnckTasklist *tasklist)
 {
   GdkWindow *tasklist_window;
+  TasklistFilter filter;
   GList *windows;
   WnckWindow *win;
   WnckClassGroup *class_group;
@@ -1696,89 +2097,83 @@ wnck_tasklist_update_lists (WnckTasklist *tasklist)
         }
       else
 	{
-	  int monitor_num;
-
-	  monitor_num = gdk_screen_get_monitor_at_window (_wnck_screen_get_gdk_screen (tasklist->priv->screen),
-							  tasklist_window);
-
-	  if (monitor_num != tasklist->priv->monitor_num)
-	    {
-	      tasklist->priv->monitor_num = monitor_num;
-	      gdk_screen_get_monitor_geometry (_wnck_screen_get_gdk_screen (tasklist->priv->screen),
-					       tasklist->priv->monitor_num,
-					       &tasklist->priv->monitor_geometry);
-	    }
+	  tasklist->priv->monitor_num = gdk_screen_get_monitor_at_window (_wnck_screen_get_gdk_screen (tasklist->priv->screen),
+									  tasklist_window);
 	}
     }
 
-  l = windows = wnck_screen_get_windows (tasklist->priv->screen);
-  while (l != NULL)
+  tasklist_filter_init (&filter, tasklist);
+  windows = _wnck_screen_filter_windows (tasklist->priv->screen,
+                                         tasklist_window_hot_filter,
+                                         &filter);
+
+  for (l = windows; l != NULL; l = l->next)
     {
       win = WNCK_WINDOW (l->data);
 
-      if (wnck_tasklist_include_window (tasklist, win))
-	{
-	  win_task = wnck_task_new_from_window (tasklist, win);
-	  tasklist->priv->windows = g_list_prepend (tasklist->priv->windows, win_task);
-	  g_hash_table_insert (tasklist->priv->win_hash, win, win_task);
+      win_task = wnck_task_new_from_window (tasklist, win);
+      tasklist->priv->windows = g_list_prepend (tasklist->priv->windows, win_task);
+      g_hash_table_insert (tasklist->priv->win_hash, win, win_task);
+
+      gtk_widget_set_parent (win_task->button, GTK_WIDGET (tasklist));
+      gtk_widget_show (win_task->button);
 
-	  gtk_widget_set_parent (win_task->button, GTK_WIDGET (tasklist));
-	  gtk_widget_show (win_task->button);
+      /* Class group */
 
-	  /* Class group */
+      class_group = wnck_window_get_class_group (win);
+      /* don't group windows if they do not belong to any class */
+      if (wnck_class_group_get_id (class_group)[0] != '\0')
+        {
+          class_group_task =
+                    g_hash_table_lookup (tasklist->priv->class_group_hash,
+                                         class_group);
 
-	  class_group = wnck_window_get_class_group (win);
-          /* don't group windows if they do not belong to any class */
-          if (strcmp (wnck_class_group_get_id (class_group), "") != 0)
+          if (class_group_task == NULL)
             {
               class_group_task =
-                        g_hash_table_lookup (tasklist->priv->class_group_hash,
-                                             class_group);
-
-              if (class_group_task == NULL)
-                {
-                  class_group_task =
-                                  wnck_task_new_from_class_group (tasklist,
-                                                                  class_group);
-                  gtk_widget_set_parent (class_group_task->button,
-                                         GTK_WIDGET (tasklist));
-                  gtk_widget_show (class_group_task->button);
-
-                  tasklist->priv->class_groups =
-                                  g_list_prepend (tasklist->priv->class_groups,
-                                                  class_group_task);
-                  g_hash_table_insert (tasklist->priv->class_group_hash,
-                                       class_group, class_group_task);
-                }
-
-              class_group_task->windows =
-                                    g_list_prepend (class_group_task->windows,
-                                                    win_task);
+                              wnck_task_new_from_class_group (tasklist,
+                                                              class_group);
+              gtk_widget_set_parent (class_group_task->button,
+                                     GTK_WIDGET (tasklist));
+              gtk_widget_show (class_group_task->button);
+
+              tasklist->priv->class_groups =
+                              g_list_prepend (tasklist->priv->class_groups,
+                                              class_group_task);
+              g_hash_table_insert (tasklist->priv->class_group_hash,
+                                   class_group, class_group_task);
             }
-          else
-            {
-              g_object_ref (win_task);
-              tasklist->priv->windows_without_class_group =
-                              g_list_prepend (tasklist->priv->windows_without_class_group,
-                                              win_task);
-            }
-	}
-      else if (tasklist_include_in_skipped_list (tasklist, win))
+
+          class_group_task->windows =
+                                g_list_prepend (class_group_task->windows,
+                                                win_task);
+        }
+      else
         {
-          skipped_window *skipped = g_new0 (skipped_window, 1);
-          skipped->window = g_object_ref (win);
-          skipped->tag = g_signal_connect (G_OBJECT (win),
-                                           "state_changed",
-                                           G_CALLBACK (wnck_task_state_changed),
-                                           tasklist);
-          tasklist->priv->skipped_windows =
-            g_list_prepend (tasklist->priv->skipped_windows,
-                            (gpointer) skipped);
+          g_object_ref (win_task);
+          tasklist->priv->windows_without_class_group =
+                          g_list_prepend (tasklist->priv->windows_without_class_group,
+                                          win_task);
         }
+    }
 
-      l = l->next;
+  g_list_free (windows);
+
+  for (l = filter.skipped; l != NULL; l = l->next)
+    {
+      skipped_window *skipped = g_new0 (skipped_window, 1);
+      skipped->window = g_object_ref (l->data);
+      skipped->tag = g_signal_connect (G_OBJECT (l->data),
+                                       "state_changed",
+                                       G_CALLBACK (wnck_task_state_changed),
+                                       tasklist);
+      tasklist->priv->skipped_windows =
+        g_list_prepend (tasklist->priv->skipped_windows,
+                        (gpointer) skipped);
     }
 
+  g_list_free (filter.skipped);
+
   /* Sort the class group list */
   l = tasklist->priv->class_groups;
   while (l)
@@ -1858,51 +2253,122 @@ wnck_tasklist_change_active_task (WnckTasklist *tasklist, WnckTask *active_task)
     }
 }
 
-static void
-wnck_tasklist_update_icon_geometries (WnckTasklist *tasklist,
-				      GList        *visible_tasks)
+/* The parent window of all the buttons is usually the same, so this
+ * remembers its origin to only ask the server once per pass.
+ */
+typedef struct
 {
-	gint x, y, width, height;
-	GList *l1;
+  GdkWindow *parent;
+  gint x;
+  gint y;
+} IconGeometryOrigin;
 
-	for (l1 = visible_tasks; l1; l1 = l1->next) {
-		WnckTask *task = WNCK_TASK (l1->data);
-                GtkAllocation allocation;
+static gboolean
+wnck_task_get_icon_geometry (WnckTask           *task,
+                             IconGeometryOrigin *origin,
+                             GdkRectangle       *rect)
+{
+  GtkAllocation allocation;
+  GdkWindow *parent;
 
-		if (!gtk_widget_get_realized (task->button))
-			continue;
+  if (!gtk_widget_get_realized (task->button) ||
+      !gtk_widget_get_child_visible (task->button))
+    return FALSE;
 
-                /* Let's cheat with some internal knowledge of GtkButton: in a
-                 * GtkButton, the window is the same as the parent window. So
-                 * to know the position of the widget, we should use the
-                 * the position of the parent window and the allocation information. */
+  /* Let's cheat with some internal knowledge of GtkButton: in a
+   * GtkButton, the window is the same as the parent window. So
+   * to know the position of the widget, we should use the
+   * the position of the parent window and the allocation information. */
 
-                gtk_widget_get_allocation (task->button, &allocation);
+  gtk_widget_get_allocation (task->button, &allocation);
 
-                gdk_window_get_origin (gtk_widget_get_parent_window (task->button),
-                                       &x, &y);
+  parent = gtk_widget_get_parent_window (task->button);
+  if (parent != origin->parent)
+    {
+      gdk_window_get_origin (parent, &origin->x, &origin->y);
+      origin->parent = parent;
+    }
+
+  rect->x = origin->x + allocation.x;
+  rect->y = origin->y + allocation.y;
+  rect->width = allocation.width;
+  rect->height = allocation.height;
+
+  return TRUE;
+}
+
+static gboolean
+wnck_tasklist_update_icon_geometries (gpointer data)
+{
+  WnckTasklist *tasklist = WNCK_TASKLIST (data);
+  IconGeometryOrigin origin;
+  GdkRectangle rect;
+  GList *l1, *l2;
 
-                x += allocation.x;
-                y += allocation.y;
-                width = allocation.width;
-                height = allocation.height;
+  tasklist->priv->icon_geometries_idle = 0;
 
-		if (task->window)
-			wnck_window_set_icon_geometry (task->window,
-						       x, y, width, height);
-		else {
-			GList *l2;
+  origin.parent = NULL;
 
-			for (l2 = task->windows; l2; l2 = l2->next) {
-				WnckTask *win_task = WNCK_TASK (l2->data);
+  /* All the property changes are sent together, and errors are not waited
+   * for: a window may be gone already. */
+  _wnck_begin_request_batch ();
 
-				g_assert (win_task->window);
+  /* Grouped windows share the button of their group */
+  for (l1 = tasklist->priv->class_groups; l1; l1 = l1->next)
+    {
+      WnckTask *task = WNCK_TASK (l1->data);
 
-				wnck_window_set_icon_geometry (win_task->window,
-							       x, y, width, height);
-			}
-		}
-	}
+      if (!wnck_task_get_icon_geometry (task, &origin, &rect))
+        continue;
+
+      for (l2 = task->windows; l2; l2 = l2->next)
+        {
+          WnckTask *win_task = WNCK_TASK (l2->data);
+
+          g_assert (win_task->window);
+
+          wnck_window_set_icon_geometry (win_task->window,
+                                         rect.x, rect.y,
+                                         rect.width, rect.height);
+        }
+    }
+
+  for (l1 = tasklist->priv->windows; l1; l1 = l1->next)
+    {
+      WnckTask *task = WNCK_TASK (l1->data);
+
+      if (!wnck_task_get_icon_geometry (task, &origin, &rect))
+        continue;
+
+      wnck_window_set_icon_geometry (task->window,
+                                     rect.x, rect.y,
+                                     rect.width, rect.height);
+    }
+
+  _wnck_end_request_batch (DisplayOfScreen (WNCK_SCREEN_XSCREEN (tasklist->priv->screen)));
+
+  return FALSE;
+}
+
+static void
+wnck_tasklist_queue_icon_geometries (WnckTasklist *tasklist)
+{
+  if (tasklist->priv->icon_geometries_idle != 0 ||
+      tasklist->priv->screen == NULL)
+    return;
+
+  tasklist->priv->icon_geometries_idle =
+    g_idle_add (wnck_tasklist_update_icon_geometries, tasklist);
+}
+
+static void
+wnck_tasklist_unqueue_icon_geometries (WnckTasklist *tasklist)
+{
+  if (tasklist->priv->icon_geometries_idle != 0)
+    {
+      g_source_remove (tasklist->priv->icon_geometries_idle);
+      tasklist->priv->icon_geometries_idle = 0;
+    }
 }
 
 static void
@@ -1990,15 +2456,38 @@ do_wnck_tasklist_update_lists (gpointer data)
   return FALSE;
 }
 
+/*
+ * We want to re-generate the task list if
+ * the window is shown but shouldn't be or
+ * the window isn't shown but should be or
+ * the tasklist itself changed monitor.
+ */
 static void
-wnck_tasklist_window_changed_geometry (WnckWindow   *window,
-				       WnckTasklist *tasklist)
+wnck_tasklist_check_window_inclusion (WnckTasklist *tasklist,
+                                      WnckWindow   *window,
+                                      gboolean      monitor_changed)
 {
-  GdkWindow *tasklist_window;
   WnckTask *win_task;
   gboolean show;
+
+  win_task = g_hash_table_lookup (tasklist->priv->win_hash, window);
+  show = wnck_tasklist_include_window (tasklist, window);
+  if (((win_task == NULL && !show) || (win_task != NULL && show)) &&
+      !monitor_changed)
+    return;
+
+  /* Don't keep any stale references */
+  gtk_widget_queue_draw (GTK_WIDGET (tasklist));
+
+  tasklist->priv->idle_callback_tag = g_idle_add (do_wnck_tasklist_update_lists, tasklist);
+}
+
+static void
+wnck_tasklist_window_changed_monitor (WnckWindow   *window,
+                                      WnckTasklist *tasklist)
+{
+  GdkWindow *tasklist_window;
   gboolean monitor_changed;
-  int x, y, w, h;
 
   if (tasklist->priv->idle_callback_tag != 0)
     return;
@@ -2007,39 +2496,36 @@ wnck_tasklist_window_changed_geometry (WnckWindow   *window,
 
   /*
    * If the (parent of the) tasklist itself skips
-   * the tasklist, we need an extra check whether
-   * the tasklist itself possibly changed monitor.
+   * the tasklist, it may be the window that just
+   * moved, taking the tasklist to another monitor.
    */
   monitor_changed = FALSE;
   if (tasklist->priv->monitor_num != -1 &&
       (wnck_window_get_state (window) & WNCK_WINDOW_STATE_SKIP_TASKLIST) &&
       tasklist_window != NULL)
-    {
-      /* Do the extra check only if there is a suspect of a monitor change (= this window is off monitor) */
-      wnck_window_get_geometry (window, &x, &y, &w, &h);
-      if (!POINT_IN_RECT (x + w / 2, y + h / 2, tasklist->priv->monitor_geometry))
-        {
-          monitor_changed = (gdk_screen_get_monitor_at_window (_wnck_screen_get_gdk_screen (tasklist->priv->screen),
-                                                               tasklist_window) != tasklist->priv->monitor_num);
-        }
-    }
+    monitor_changed = (gdk_screen_get_monitor_at_window (_wnck_screen_get_gdk_screen (tasklist->priv->screen),
+                                                         tasklist_window) != tasklist->priv->monitor_num);
 
-  /*
-   * We want to re-generate the task list if
-   * the window is shown but shouldn't be or
-   * the window isn't shown but should be or
-   * the tasklist itself changed monitor.
-   */
-  win_task = g_hash_table_lookup (tasklist->priv->win_hash, window);
-  show = wnck_tasklist_include_window (tasklist, window);
-  if (((win_task == NULL && !show) || (win_task != NULL && show)) &&
-      !monitor_changed)
+  wnck_tasklist_check_window_inclusion (tasklist, window, monitor_changed);
+}
+
+static void
+wnck_tasklist_window_changed_geometry (WnckWindow   *window,
+				       WnckTasklist *tasklist)
+{
+  WnckWorkspace *active_workspace;
+
+  if (tasklist->priv->idle_callback_tag != 0)
     return;
 
-  /* Don't keep any stale references */
-  gtk_widget_queue_draw (GTK_WIDGET (tasklist));
+  /* Moving to another monitor is handled by "monitor_changed"; the
+   * geometry only matters for the viewport of a virtual workspace. */
+  active_workspace = wnck_screen_get_active_workspace (tasklist->priv->screen);
+  if (active_workspace == NULL ||
+      !wnck_workspace_is_virtual (active_workspace))
+    return;
 
-  tasklist->priv->idle_callback_tag = g_idle_add (do_wnck_tasklist_update_lists, tasklist);
+  wnck_tasklist_check_window_inclusion (tasklist, window, FALSE);
 }
 
 static void
@@ -2052,6 +2538,9 @@ wnck_tasklist_connect_window (WnckTasklist *tasklist,
   g_signal_connect_object (window, "geometry_changed",
 			   G_CALLBACK (wnck_tasklist_window_changed_geometry),
 			   tasklist, 0);
+  g_signal_connect_object (window, "monitor_changed",
+			   G_CALLBACK (wnck_tasklist_window_changed_monitor),
+			   tasklist, 0);
 }
 
 static void
@@ -2064,6 +2553,9 @@ wnck_tasklist_disconnect_window (WnckTasklist *tasklist,
   g_signal_handlers_disconnect_by_func (window,
                                         wnck_tasklist_window_changed_geometry,
                                         tasklist);
+  g_signal_handlers_disconnect_by_func (window,
+                                        wnck_tasklist_window_changed_monitor,
+                                        tasklist);
 }
 
 static void
@@ -2179,51 +2671,132 @@ wnck_tasklist_activate_task_window (WnckTask *task,
  */
 #define STARTUP_TIMEOUT 15000
 
+/* in milliseconds, like STARTUP_TIMEOUT */
+static gint64
+sequence_get_current_time (void)
+{
+  GTimeVal now;
+
+  g_get_current_time (&now);
+
+  return (gint64) now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+static gint64
+sequence_get_deadline (WnckTask *task)
+{
+  long tv_sec, tv_usec;
+
+  sn_startup_sequence_get_last_active_time (task->startup_sequence,
+                                            &tv_sec, &tv_usec);
+
+  return (gint64) tv_sec * 1000 + tv_usec / 1000 + STARTUP_TIMEOUT;
+}
+
+static gint
+sequence_compare_deadlines (gconstpointer a,
+                            gconstpointer b,
+                            gpointer      data)
+{
+  gint64 deadline_a;
+  gint64 deadline_b;
+
+  deadline_a = sequence_get_deadline (WNCK_TASK (a));
+  deadline_b = sequence_get_deadline (WNCK_TASK (b));
+
+  if (deadline_a < deadline_b)
+    return -1;
+  else if (deadline_a > deadline_b)
+    return 1;
+  else
+    return 0;
+}
+
 static gboolean
 sequence_timeout_callback (void *user_data)
 {
   WnckTasklist *tasklist = user_data;
+  GList *expired;
   GList *tmp;
-  GTimeVal now;
-  long tv_sec, tv_usec;
-  double elapsed;
+  WnckTask *task;
+  gint64 now;
 
-  g_get_current_time (&now);
+  tasklist->priv->startup_sequence_timeout = 0;
 
- restart:
-  tmp = tasklist->priv->startup_sequences;
-  while (tmp != NULL)
-    {
-      WnckTask *task = WNCK_TASK (tmp->data);
+  now = sequence_get_current_time ();
 
-      sn_startup_sequence_get_last_active_time (task->startup_sequence,
-                                                &tv_sec, &tv_usec);
+  expired = NULL;
+  while ((task = g_queue_peek_head (tasklist->priv->startup_deadlines)) &&
+         sequence_get_deadline (task) <= now)
+    expired = g_list_prepend (expired,
+                              g_queue_pop_head (tasklist->priv->startup_deadlines));
 
-      elapsed =
-        ((((double)now.tv_sec - tv_sec) * G_USEC_PER_SEC +
-          (now.tv_usec - tv_usec))) / 1000.0;
+  if (expired != NULL)
+    {
+      tasklist->priv->expiring_sequences = TRUE;
 
-      if (elapsed > STARTUP_TIMEOUT)
+      for (tmp = expired; tmp != NULL; tmp = tmp->next)
         {
+          task = WNCK_TASK (tmp->data);
+
           g_assert (task->button != NULL);
           /* removes task from list as a side effect */
           gtk_widget_destroy (task->button);
-
-          goto restart; /* don't iterate over changed list, just restart;
-                         * not efficient but who cares here.
-                         */
         }
 
-      tmp = tmp->next;
+      tasklist->priv->expiring_sequences = FALSE;
+
+      g_list_free (expired);
+
+      gtk_widget_queue_resize (GTK_WIDGET (tasklist));
     }
 
-  if (tasklist->priv->startup_sequences == NULL)
+  wnck_tasklist_arm_sequence_timeout (tasklist);
+
+  return FALSE;
+}
+
+static void
+wnck_tasklist_arm_sequence_timeout (WnckTasklist *tasklist)
+{
+  WnckTask *first;
+  gint64 delay;
+
+  if (tasklist->priv->startup_sequence_timeout != 0)
     {
+      g_source_remove (tasklist->priv->startup_sequence_timeout);
       tasklist->priv->startup_sequence_timeout = 0;
-      return FALSE;
     }
-  else
-    return TRUE;
+
+  first = g_queue_peek_head (tasklist->priv->startup_deadlines);
+  if (first == NULL)
+    return;
+
+  delay = sequence_get_deadline (first) - sequence_get_current_time ();
+  delay = CLAMP (delay, 0, STARTUP_TIMEOUT);
+
+  tasklist->priv->startup_sequence_timeout =
+    g_timeout_add ((guint) delay, sequence_timeout_callback, tasklist);
+}
+
+/* (Re)inserts task at the position of its deadline, and rearms the timeout
+ * if the first deadline changed. */
+static void
+wnck_tasklist_schedule_sequence (WnckTasklist *tasklist,
+                                 WnckTask     *task)
+{
+  WnckTask *first;
+
+  first = g_queue_peek_head (tasklist->priv->startup_deadlines);
+
+  g_queue_remove (tasklist->priv->startup_deadlines, task);
+  g_queue_insert_sorted (tasklist->priv->startup_deadlines, task,
+                         sequence_compare_deadlines, NULL);
+
+  if (tasklist->priv->startup_sequence_timeout == 0 ||
+      g_queue_peek_head (tasklist->priv->startup_deadlines) != first ||
+      first == task)
+    wnck_tasklist_arm_sequence_timeout (tasklist);
 }
 
 static void
@@ -2250,12 +2823,7 @@ wnck_tasklist_sn_event (SnMonitorEvent *event,
           g_list_prepend (tasklist->priv->startup_sequences,
                           task);
 
-        if (tasklist->priv->startup_sequence_timeout == 0)
-          {
-            tasklist->priv->startup_sequence_timeout =
-              g_timeout_add_seconds (1, sequence_timeout_callback,
-                                     tasklist);
-          }
+        wnck_tasklist_schedule_sequence (tasklist, task);
 
         gtk_widget_queue_resize (GTK_WIDGET (tasklist));
       }
@@ -2284,6 +2852,24 @@ wnck_tasklist_sn_event (SnMonitorEvent *event,
       break;
 
     case SN_MONITOR_EVENT_CHANGED:
+      {
+        GList *tmp;
+        tmp = tasklist->priv->startup_sequences;
+        while (tmp != NULL)
+          {
+            WnckTask *task = WNCK_TASK (tmp->data);
+
+            /* the sequence is active again, so it expires later */
+            if (task->startup_sequence ==
+                sn_monitor_event_get_startup_sequence (event))
+              {
+                wnck_tasklist_schedule_sequence (tasklist, task);
+                break;
+              }
+
+            tmp = tmp->next;
+          }
+      }
       break;
 
     case SN_MONITOR_EVENT_CANCELED:
@@ -2321,11 +2907,12 @@ wnck_tasklist_check_end_sequence (WnckTasklist   *tasklist,
       WnckTask *task = WNCK_TASK (tmp->data);
       const char *wmclass;
 
-      wmclass = sn_startup_sequence_get_wmclass (task->startup_sequence);
+      /* window class names are interned: if wmclass is not in the pool,
+       * no window can match it, otherwise a pointer comparison is enough */
+      wmclass = _wnck_intern_lookup (sn_startup_sequence_get_wmclass (task->startup_sequence));
 
       if (wmclass != NULL &&
-          ((res_class && strcmp (res_class, wmclass) == 0) ||
-           (res_name && strcmp (res_name, wmclass) == 0)))
+          (res_class == wmclass || res_name == wmclass))
         {
           sn_startup_sequence_complete (task->startup_sequence);
 
@@ -29,6 +29,7 @@
 #include "private.h"
 #include "inlinepixbufs.h"
 #include <gdk/gdkx.h>
+#include <stdlib.h>
 #include <string.h>
 #ifdef HAVE_XRES
 #include <X11/extensions/XRes.h>
@@ -484,6 +485,162 @@ wnck_pid_read_resource_usage_destroy_hash_table (gpointer data)
   return FALSE;
 }
 
+#ifdef HAVE_XRES_CLIENT_IDS
+static gboolean
+wnck_xres_has_client_ids (GdkDisplay *gdisplay)
+{
+  WnckExtStatus status;
+
+  status = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (gdisplay),
+                                               "wnck-xres-client-ids-status"));
+
+  if (status == WNCK_EXT_UNKNOWN)
+    {
+      Display *xdisplay;
+      int      major;
+      int      minor;
+      Status   result;
+
+      xdisplay = GDK_DISPLAY_XDISPLAY (gdisplay);
+      major = 0;
+      minor = 0;
+
+      _wnck_error_trap_push (xdisplay);
+      result = XResQueryVersion (xdisplay, &major, &minor);
+      _wnck_error_trap_pop (xdisplay);
+
+      /* client IDs were added in version 1.2 of the extension */
+      if (result && (major > 1 || (major == 1 && minor >= 2)))
+        status = WNCK_EXT_FOUND;
+      else
+        status = WNCK_EXT_MISSING;
+
+      g_object_set_data (G_OBJECT (gdisplay),
+                         "wnck-xres-client-ids-status",
+                         GINT_TO_POINTER (status));
+    }
+
+  return status == WNCK_EXT_FOUND;
+}
+
+/* The X server only knows the PID of local clients, so every PID in a cache
+ * built from client IDs is a local process: if /proc is available and has no
+ * entry for it, the process is gone and there is no need to ask the X server
+ * about it. */
+static gboolean
+wnck_pid_is_gone (gulong pid)
+{
+  static int has_proc = -1;
+  char       path[64];
+
+  if (has_proc == -1)
+    has_proc = g_file_test ("/proc/self", G_FILE_TEST_IS_DIR);
+
+  if (!has_proc)
+    return FALSE;
+
+  g_snprintf (path, sizeof (path), "/proc/%lu", pid);
+
+  return !g_file_test (path, G_FILE_TEST_EXISTS);
+}
+
+static gboolean
+wnck_pid_read_resource_usage_remove_departed (gpointer key,
+                                              gpointer value,
+                                              gpointer data)
+{
+  GHashTable *clients = data;
+
+  return g_hash_table_lookup (clients,
+                              GSIZE_TO_POINTER (*(gulong *) value)) == NULL;
+}
+
+static void
+wnck_pid_read_resource_usage_update_client_ids (GdkDisplay *gdisplay)
+{
+  Display           *xdisplay;
+  XResClientIdSpec   spec;
+  XResClientIdValue *ids;
+  long               n_ids;
+  long               i;
+  Status             result;
+  int                err;
+  GHashTable        *clients;
+
+  xdisplay = GDK_DISPLAY_XDISPLAY (gdisplay);
+
+  /* a spec without a client matches all clients, so this is one request for
+   * the PID of every client, instead of a walk through the window tree */
+  spec.client = None;
+  spec.mask = XRES_CLIENT_ID_PID_MASK;
+  ids = NULL;
+  n_ids = 0;
+
+  time (&start_update);
+
+  _wnck_error_trap_push (xdisplay);
+  result = XResQueryClientIds (xdisplay, 1, &spec, &n_ids, &ids);
+  err = _wnck_error_trap_pop (xdisplay);
+
+  if (result != Success || err != Success)
+    {
+      if (ids)
+        XResClientIdsDestroy (n_ids, ids);
+      return;
+    }
+
+  if (xres_hashtable == NULL)
+    xres_hashtable = g_hash_table_new_full (
+                                     wnck_gulong_hash,
+                                     wnck_gulong_equal,
+                                     wnck_pid_read_resource_usage_free_hash,
+                                     wnck_pid_read_resource_usage_free_hash);
+
+  /* the cached XID of a PID is the resource base of its client: drop the
+   * PIDs whose client has disconnected since the last update */
+  clients = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  for (i = 0; i < n_ids; i++)
+    if (XResGetClientPid (&ids[i]) > 0)
+      g_hash_table_insert (clients,
+                           GSIZE_TO_POINTER (ids[i].spec.client),
+                           GINT_TO_POINTER (TRUE));
+
+  g_hash_table_foreach_remove (xres_hashtable,
+                               wnck_pid_read_resource_usage_remove_departed,
+                               clients);
+  g_hash_table_destroy (clients);
+
+  /* and only add the PIDs we don't know yet */
+  for (i = 0; i < n_ids; i++)
+    {
+      pid_t   client_pid;
+      gulong  pid;
+      gulong *key;
+      gulong *value;
+
+      client_pid = XResGetClientPid (&ids[i]);
+      if (client_pid <= 0)
+        continue;
+
+      pid = client_pid;
+
+      if (g_hash_table_lookup (xres_hashtable, &pid) != NULL)
+        continue;
+
+      key = g_slice_new (gulong);
+      value = g_slice_new (gulong);
+      *key = pid;
+      *value = ids[i].spec.client;
+      g_hash_table_insert (xres_hashtable, key, value);
+    }
+
+  XResClientIdsDestroy (n_ids, ids);
+
+  time (&end_update);
+}
+#endif /* HAVE_XRES_CLIENT_IDS */
+
 #define XRES_UPDATE_RATE_SEC 30
 static gboolean
 wnck_pid_read_resource_usage_from_cache (GdkDisplay        *gdisplay,
@@ -493,6 +650,9 @@ wnck_pid_read_resource_usage_from_cache (GdkDisplay        *gdisplay,
   gboolean  need_rebuild;
   gulong   *xid_p;
   int       cache_validity;
+#ifdef HAVE_XRES_CLIENT_IDS
+  gboolean  use_client_ids;
+#endif
 
   if (end_update == 0)
     time (&end_update);
@@ -503,6 +663,17 @@ wnck_pid_read_resource_usage_from_cache (GdkDisplay        *gdisplay,
   need_rebuild = (xres_hashtable == NULL ||
                   (end_update < time (NULL) - cache_validity));
 
+#ifdef HAVE_XRES_CLIENT_IDS
+  use_client_ids = wnck_xres_has_client_ids (gdisplay);
+
+  if (use_client_ids && wnck_pid_is_gone (pid))
+    {
+      if (xres_hashtable)
+        g_hash_table_remove (xres_hashtable, &pid);
+      return FALSE;
+    }
+#endif
+
   if (xres_hashtable)
     {
       /* clear the cache after quite some time, because it might not be used
@@ -515,13 +686,34 @@ wnck_pid_read_resource_usage_from_cache (GdkDisplay        *gdisplay,
     }
 
   if (need_rebuild)
-    wnck_pid_read_resource_usage_start_build_cache (gdisplay);
+    {
+#ifdef HAVE_XRES_CLIENT_IDS
+      if (use_client_ids)
+        wnck_pid_read_resource_usage_update_client_ids (gdisplay);
+      else
+#endif
+        wnck_pid_read_resource_usage_start_build_cache (gdisplay);
+    }
 
   if (xres_hashtable)
     xid_p = g_hash_table_lookup (xres_hashtable, &pid);
   else
     xid_p = NULL;
 
+#ifdef HAVE_XRES_CLIENT_IDS
+  /* updating the cache is a single request, so a client that connected
+   * since the last update can be picked up right away; this is still
+   * limited to once per second */
+  if (xid_p == NULL && use_client_ids && !need_rebuild &&
+      end_update < time (NULL))
+    {
+      wnck_pid_read_resource_usage_update_client_ids (gdisplay);
+
+      if (xres_hashtable)
+        xid_p = g_hash_table_lookup (xres_hashtable, &pid);
+    }
+#endif
+
   if (xid_p)
     {
       wnck_xid_read_resource_usage (gdisplay, *xid_p, usage);
@@ -594,6 +786,11 @@ wnck_pid_read_resource_usage_no_cache (GdkDisplay        *gdisplay,
  * it is an X client. If this happens, calling wnck_pid_read_resource_usage()
  * again after a few seconds should work.
  *
+ * If the X server supports version 1.2 of the XRes extension, the X server is
+ * instead asked for the process ID of all its clients in a single request,
+ * and the cache is only updated for X clients that connected or disconnected
+ * since the last update.
+ *
  * To properly work, this function requires the XRes extension on the X server.
  *
  * Since: 2.6
@@ -712,10 +909,13 @@ _wnck_util_sn_utf8_validator (const char *str,
 }
 #endif /* HAVE_STARTUP_NOTIFICATION */
 
+static gboolean dump_memory_usage_timeout (gpointer data);
+
 void
 _wnck_init (void)
 {
   static gboolean done = FALSE;
+  const char *debug_memory;
 
   if (!done)
     {
@@ -726,6 +926,18 @@ _wnck_init (void)
       sn_set_utf8_validator (_wnck_util_sn_utf8_validator);
 #endif /* HAVE_STARTUP_NOTIFICATION */
 
+      debug_memory = g_getenv ("WNCK_DEBUG_MEMORY");
+      if (debug_memory != NULL)
+        {
+          int interval;
+
+          interval = atoi (debug_memory);
+          if (interval <= 0)
+            interval = 60;
+
+          g_timeout_add_seconds (interval, dump_memory_usage_timeout, NULL);
+        }
+
       done = TRUE;
     }
 }
@@ -738,6 +950,221 @@ _wnck_get_default_display (void)
   return GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
 }
 
+/* Pool of the identifier strings shared by many windows (WM_CLASS, session
+ * and startup ids). Each distinct string is stored once, with a count of
+ * its users, so that windows of the same application share their copies
+ * and can be compared by pointer. The pool goes away with its last string.
+ */
+typedef struct
+{
+  guint refcount;
+  char  str[1];
+} InternedString;
+
+static GHashTable *intern_pool = NULL;
+
+const char *
+_wnck_intern_string (const char *str)
+{
+  InternedString *interned;
+  gsize len;
+
+  if (str == NULL)
+    return NULL;
+
+  if (intern_pool == NULL)
+    intern_pool = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         NULL, g_free);
+
+  interned = g_hash_table_lookup (intern_pool, str);
+  if (interned != NULL)
+    {
+      interned->refcount++;
+      return interned->str;
+    }
+
+  len = strlen (str);
+  interned = g_malloc (G_STRUCT_OFFSET (InternedString, str) + len + 1);
+  interned->refcount = 1;
+  memcpy (interned->str, str, len + 1);
+
+  g_hash_table_insert (intern_pool, interned->str, interned);
+
+  return interned->str;
+}
+
+/* Takes ownership of @str, which must have been allocated with g_malloc() */
+const char *
+_wnck_intern_string_take (char *str)
+{
+  const char *interned;
+
+  interned = _wnck_intern_string (str);
+  g_free (str);
+
+  return interned;
+}
+
+void
+_wnck_intern_release (const char *str)
+{
+  InternedString *interned;
+
+  if (str == NULL)
+    return;
+
+  g_return_if_fail (intern_pool != NULL);
+
+  interned = g_hash_table_lookup (intern_pool, str);
+  g_return_if_fail (interned != NULL && interned->str == str);
+
+  if (--interned->refcount > 0)
+    return;
+
+  g_hash_table_remove (intern_pool, str);
+
+  if (g_hash_table_size (intern_pool) == 0)
+    {
+      g_hash_table_destroy (intern_pool);
+      intern_pool = NULL;
+    }
+}
+
+/* Returns the pooled copy of @str without taking a reference, or %NULL if
+ * nobody uses @str.
+ */
+const char *
+_wnck_intern_lookup (const char *str)
+{
+  InternedString *interned;
+
+  if (str == NULL || intern_pool == NULL)
+    return NULL;
+
+  interned = g_hash_table_lookup (intern_pool, str);
+
+  return interned ? interned->str : NULL;
+}
+
+static void
+intern_pool_add_memory_usage (gpointer key,
+                              gpointer value,
+                              gpointer data)
+{
+  InternedString *interned = value;
+  WnckMemoryUsage *usage = data;
+
+  usage->n_strings++;
+  usage->string_bytes += G_STRUCT_OFFSET (InternedString, str) +
+                         strlen (interned->str) + 1;
+  usage->n_string_references += interned->refcount;
+}
+
+/* Counts @pixbuf in @usage, unless it is in @pixbufs already: icons are
+ * often shared between windows, applications and class groups. The scaled
+ * and dimmed variants of @pixbuf are counted too.
+ */
+void
+_wnck_memory_usage_add_pixbuf (WnckMemoryUsage *usage,
+                               GHashTable      *pixbufs,
+                               GdkPixbuf       *pixbuf)
+{
+  if (pixbuf == NULL || g_hash_table_lookup (pixbufs, pixbuf) != NULL)
+    return;
+
+  g_hash_table_insert (pixbufs, pixbuf, pixbuf);
+
+  usage->n_icons++;
+  usage->icon_bytes += gdk_pixbuf_get_rowstride (pixbuf) *
+                       gdk_pixbuf_get_height (pixbuf);
+
+  _wnck_icon_variants_add_memory_usage (usage, pixbufs, pixbuf);
+}
+
+/**
+ * wnck_read_memory_usage:
+ * @usage: return location for the memory usage of libwnck.
+ *
+ * Looks at all the objects libwnck keeps in the current process, and fills
+ * @usage with their number and size. This does not talk to the X server, and
+ * can be used to track down leaks and bloat in long-running processes. See
+ * also wnck_dump_memory_usage().
+ *
+ * Since: 3.4
+ */
+void
+wnck_read_memory_usage (WnckMemoryUsage *usage)
+{
+  GHashTable *pixbufs;
+
+  g_return_if_fail (usage != NULL);
+
+  memset (usage, '\0', sizeof (*usage));
+
+  pixbufs = g_hash_table_new (NULL, NULL);
+
+  _wnck_screen_add_memory_usage (usage);
+  _wnck_window_add_memory_usage (usage, pixbufs);
+  _wnck_application_add_memory_usage (usage, pixbufs);
+  _wnck_class_group_add_memory_usage (usage, pixbufs);
+  _wnck_tasklist_add_memory_usage (usage);
+  _wnck_pager_add_memory_usage (usage, pixbufs);
+  _wnck_fallback_icons_add_memory_usage (usage, pixbufs);
+
+  if (intern_pool != NULL)
+    g_hash_table_foreach (intern_pool, intern_pool_add_memory_usage, usage);
+
+  g_hash_table_destroy (pixbufs);
+}
+
+/**
+ * wnck_dump_memory_usage:
+ *
+ * Prints the memory usage of libwnck, as returned by
+ * wnck_read_memory_usage(), on the standard error. If the
+ * <envar>WNCK_DEBUG_MEMORY</envar> environment variable is set to a number of
+ * seconds, this is done periodically.
+ *
+ * Since: 3.4
+ */
+void
+wnck_dump_memory_usage (void)
+{
+  WnckMemoryUsage usage;
+
+  wnck_read_memory_usage (&usage);
+
+  g_printerr ("libwnck memory usage:\n"
+              "\tscreens         : %u\n"
+              "\twindows         : %u (%lu bytes)\n"
+              "\tapplications    : %u (%lu bytes)\n"
+              "\tclass groups    : %u (%lu bytes)\n"
+              "\ticons           : %u (%lu bytes)\n"
+              "\ticon caches     : %u\n"
+              "\tstrings         : %u (%lu bytes, %u references)\n"
+              "\ttasklists       : %u (%u buttons)\n"
+              "\tpending sources : %u\n"
+              "\ttick callbacks  : %u\n",
+              usage.n_screens,
+              usage.n_windows, usage.window_bytes,
+              usage.n_applications, usage.application_bytes,
+              usage.n_class_groups, usage.class_group_bytes,
+              usage.n_icons, usage.icon_bytes,
+              usage.n_icon_caches,
+              usage.n_strings, usage.string_bytes, usage.n_string_references,
+              usage.n_tasklists, usage.n_tasklist_buttons,
+              usage.n_pending_sources,
+              usage.n_tick_callbacks);
+}
+
+static gboolean
+dump_memory_usage_timeout (gpointer data)
+{
+  wnck_dump_memory_usage ();
+
+  return TRUE;
+}
+
 /* stock icon code Copyright (C) 2002 Jorn Baayen <jorn@nl.linux.org> */
 typedef struct
 {
@@ -826,6 +1253,8 @@ wnck_shutdown (void)
   _wnck_application_shutdown_all ();
   _wnck_screen_shutdown_all ();
   _wnck_window_shutdown_all ();
+  _wnck_fallback_icons_shutdown ();
+  _wnck_pixmap_shm_shutdown ();
 
 #ifdef HAVE_XRES
   if (xres_removeid != 0)
@@ -87,6 +87,80 @@ struct _WnckResourceUsage
   unsigned long pad9;
 };
 
+typedef struct _WnckMemoryUsage WnckMemoryUsage;
+
+/**
+ * WnckMemoryUsage:
+ * @n_screens: number of #WnckScreen.
+ * @n_windows: number of #WnckWindow.
+ * @n_applications: number of #WnckApplication.
+ * @n_class_groups: number of #WnckClassGroup.
+ * @n_tasklists: number of realized #WnckTasklist.
+ * @n_tasklist_buttons: number of buttons of the realized #WnckTasklist, for
+ * windows, groups of windows and startup sequences.
+ * @window_bytes: number of bytes used by the #WnckWindow structures, their
+ * names and icon names.
+ * @application_bytes: number of bytes used by the #WnckApplication
+ * structures and their names.
+ * @class_group_bytes: number of bytes used by the #WnckClassGroup structures
+ * and their names.
+ * @n_icons: number of distinct icons held by windows, applications and class
+ * groups, including their scaled and dimmed variants, the fallback icons and
+ * the background thumbnails of the pagers.
+ * @icon_bytes: number of bytes of pixel data of these icons.
+ * @n_icon_caches: number of icon caches, tracking the icon properties of
+ * windows and applications.
+ * @n_strings: number of distinct identifier strings (resource classes and
+ * names, session and startup IDs) shared by the objects.
+ * @string_bytes: number of bytes used by these strings.
+ * @n_string_references: number of references to these strings; the difference
+ * with @n_strings is the number of copies saved by sharing them.
+ * @n_pending_sources: number of idle and timeout sources pending in screens
+ * and tasklists.
+ * @n_tick_callbacks: number of frame clock tick callbacks installed by the
+ * tasklists for their animations; they are not #GSource and run only while
+ * the tasklist is drawn.
+ *
+ * The #WnckMemoryUsage struct contains information about the memory held by
+ * libwnck in the current process, per type of object. See
+ * wnck_read_memory_usage().
+ *
+ * Since: 3.4
+ */
+struct _WnckMemoryUsage
+{
+  unsigned int n_screens;
+  unsigned int n_windows;
+  unsigned int n_applications;
+  unsigned int n_class_groups;
+  unsigned int n_tasklists;
+  unsigned int n_tasklist_buttons;
+
+  gulong       window_bytes;
+  gulong       application_bytes;
+  gulong       class_group_bytes;
+
+  unsigned int n_icons;
+  gulong       icon_bytes;
+  unsigned int n_icon_caches;
+
+  unsigned int n_strings;
+  gulong       string_bytes;
+  unsigned int n_string_references;
+
+  unsigned int n_pending_sources;
+  unsigned int n_tick_callbacks;
+
+  /*< private >*/
+  unsigned int pad2;
+  unsigned int pad3;
+  unsigned int pad4;
+  unsigned long pad5;
+  unsigned long pad6;
+  unsigned long pad7;
+  unsigned long pad8;
+};
+
 /**
  * WnckClientType:
  * @WNCK_CLIENT_TYPE_APPLICATION: the libwnck user is a normal application.
@@ -114,6 +188,9 @@ void wnck_pid_read_resource_usage (GdkDisplay        *gdk_display,
                                    gulong             pid,
                                    WnckResourceUsage *usage);
 
+void wnck_read_memory_usage (WnckMemoryUsage *usage);
+void wnck_dump_memory_usage (void);
+
 G_END_DECLS
 
 #endif /* WNCK_UTIL_H */
@@ -48,27 +48,37 @@
  */
 
 #define FALLBACK_NAME _("Untitled window")
-#define ALL_WORKSPACES (0xFFFFFFFF)
 
 static GHashTable *window_hash = NULL;
+/* frame (parent) of windows -> FrameClients, no reference held */
+static GHashTable *frame_hash = NULL;
+
+/* Most frames have one client, but nothing prevents several managed windows
+ * from sharing a parent: the frame is only released with its last client.
+ */
+typedef struct
+{
+  Window  frame;
+  GSList *windows;
+} FrameClients;
 
 /* Keep 0-7 in sync with the numbers in the WindowState enum. Yeah I'm
  * a loser.
  */
-#define COMPRESS_STATE(window)                          \
-  ( ((window)->priv->is_minimized        << 0) |        \
-    ((window)->priv->is_maximized_horz   << 1) |        \
-    ((window)->priv->is_maximized_vert   << 2) |        \
-    ((window)->priv->is_shaded           << 3) |        \
-    ((window)->priv->skip_pager          << 4) |        \
-    ((window)->priv->skip_taskbar        << 5) |        \
-    ((window)->priv->is_sticky           << 6) |        \
-    ((window)->priv->is_hidden           << 7) |        \
-    ((window)->priv->is_fullscreen       << 8) |        \
-    ((window)->priv->demands_attention   << 9) |        \
-    ((window)->priv->is_urgent           << 10)|        \
-    ((window)->priv->is_above            << 11)|        \
-    ((window)->priv->is_below            << 12))
+#define COMPRESS_STATE(window)                               \
+  ( ((window)->priv->hot->is_minimized        << 0) |        \
+    ((window)->priv->hot->is_maximized_horz   << 1) |        \
+    ((window)->priv->hot->is_maximized_vert   << 2) |        \
+    ((window)->priv->hot->is_shaded           << 3) |        \
+    ((window)->priv->hot->skip_pager          << 4) |        \
+    ((window)->priv->hot->skip_taskbar        << 5) |        \
+    ((window)->priv->hot->is_sticky           << 6) |        \
+    ((window)->priv->hot->is_hidden           << 7) |        \
+    ((window)->priv->hot->is_fullscreen       << 8) |        \
+    ((window)->priv->hot->demands_attention   << 9) |        \
+    ((window)->priv->hot->is_urgent           << 10)|        \
+    ((window)->priv->hot->is_above            << 11)|        \
+    ((window)->priv->hot->is_below            << 12))
 
 struct _WnckWindowPrivate
 {
@@ -77,60 +87,66 @@ struct _WnckWindowPrivate
   WnckApplication *app;
   WnckClassGroup *class_group;
   Window group_leader;
-  Window transient_for;
   int orig_event_mask;
   GdkRectangle icon_geometry;
   char *name;
   char *icon_name;
-  char *session_id;
-  char *session_id_utf8;
+  /* which property the name and icon name were last read from, and the
+   * ones that changed since then (1 << WnckNameSource)
+   */
+  WnckNameSource name_source;
+  WnckNameSource icon_name_source;
+  guint name_changes : 3;
+  guint icon_name_changes : 3;
+  /* identifiers are interned, see _wnck_intern_string() */
+  const char *session_id;
+  const char *session_id_utf8;
   int pid;
-  int workspace;
   gint sort_order;
 
-  WnckWindowType wintype;
+  /* state read by scans over all windows: in a record owned by the screen
+   * while the window is on it, or in a record of our own (hot_detached)
+   * before _wnck_window_create() and after _wnck_window_destroy()
+   */
+  WnckWindowHot *hot;
 
-  GdkPixbuf *icon;
-  GdkPixbuf *mini_icon;
+  /* result of transient_needs_attention(), valid while
+   * transient_attention_serial is the transients serial of the screen */
+  WnckWindow *transient_attention;
+  guint transient_attention_serial;
 
   WnckIconCache *icon_cache;
 
   WnckWindowActions actions;
 
-  int x;
-  int y;
-  int width;
-  int height;
-
   int left_frame;
   int right_frame;
   int top_frame;
   int bottom_frame;
 
-  char *startup_id;
+  /* The parent of xwindow (None if it is the root window), usually the
+   * frame of the window manager. x and y are derived from the position of
+   * xwindow in the frame and from the position of the frame, which are
+   * both tracked with ConfigureNotify, so that they never need a round-trip.
+   * frame_parent_x/y is the root position of the parent of the frame. If
+   * the frame is not a child of the root window (window managers that
+   * reparent twice), the windows around it can move without any event we
+   * listen to, and the position is asked to the X server instead.
+   */
+  Window frame;
+  int frame_x;
+  int frame_y;
+  int frame_parent_x;
+  int frame_parent_y;
+  int x_in_frame;
+  int y_in_frame;
 
-  char *res_class;
-  char *res_name;
+  const char *startup_id;
 
-  /* true if transient_for points to root window,
-   * not another app window
-   */
-  guint transient_for_root : 1;
-
-  /* window state */
-  guint is_minimized : 1;
-  guint is_maximized_horz : 1;
-  guint is_maximized_vert : 1;
-  guint is_shaded : 1;
-  guint is_above : 1;
-  guint is_below : 1;
-  guint skip_pager : 1;
-  guint skip_taskbar : 1;
-  guint is_sticky : 1;
-  guint is_hidden : 1;
-  guint is_fullscreen : 1;
-  guint demands_attention : 1;
-  guint is_urgent : 1;
+  const char *res_class;
+  const char *res_name;
+
+  guint hot_detached : 1;
 
   time_t needs_attention_time;
 
@@ -141,8 +157,13 @@ struct _WnckWindowPrivate
   guint net_wm_state_hidden : 1;
   guint wm_state_iconic : 1;
 
-  /* idle handler for updates */
-  guint update_handler;
+  guint frame_is_toplevel : 1;
+
+  /* the screen will call force_update_now() in its idle handler */
+  guint update_queued : 1;
+  /* window is in the queue of dirty windows of the screen, even if its
+   * update was unqueued since: it must not be added a second time */
+  guint in_dirty_queue : 1;
 
   /* if you add flags, be sure to set them
    * when we create the window so we get an initial update
@@ -174,6 +195,7 @@ enum {
   ICON_CHANGED,
   ACTIONS_CHANGED,
   GEOMETRY_CHANGED,
+  MONITOR_CHANGED,
   LAST_SIGNAL
 };
 
@@ -191,6 +213,7 @@ static void emit_actions_changed   (WnckWindow       *window,
                                     WnckWindowActions changed_mask,
                                     WnckWindowActions new_actions);
 static void emit_geometry_changed  (WnckWindow      *window);
+static void emit_monitor_changed   (WnckWindow      *window);
 
 static void update_name      (WnckWindow *window);
 static void update_state     (WnckWindow *window);
@@ -207,8 +230,10 @@ static void unqueue_update   (WnckWindow *window);
 static void queue_update     (WnckWindow *window);
 static void force_update_now (WnckWindow *window);
 
-static WnckWindow* find_last_transient_for (GList *windows,
-                                            Window xwindow);
+static void update_frame_tree (WnckWindow *window);
+static void unset_frame       (WnckWindow *window);
+
+static WnckWindow* find_last_transient_for (WnckWindow *window);
 
 static guint signals[LAST_SIGNAL] = { 0 };
 
@@ -220,6 +245,44 @@ _wnck_window_shutdown_all (void)
       g_hash_table_destroy (window_hash);
       window_hash = NULL;
     }
+
+  if (frame_hash != NULL)
+    {
+      g_hash_table_destroy (frame_hash);
+      frame_hash = NULL;
+    }
+}
+
+void
+_wnck_window_add_memory_usage (WnckMemoryUsage *usage,
+                               GHashTable      *pixbufs)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  if (window_hash == NULL)
+    return;
+
+  g_hash_table_iter_init (&iter, window_hash);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      WnckWindow *window = value;
+
+      usage->n_windows++;
+      usage->window_bytes += sizeof (WnckWindow) +
+                             sizeof (WnckWindowPrivate) +
+                             sizeof (WnckWindowHot);
+      if (window->priv->name)
+        usage->window_bytes += strlen (window->priv->name) + 1;
+      if (window->priv->icon_name)
+        usage->window_bytes += strlen (window->priv->icon_name) + 1;
+
+      if (window->priv->icon_cache)
+        usage->n_icon_caches++;
+
+      _wnck_memory_usage_add_pixbuf (usage, pixbufs, window->priv->hot->icon);
+      _wnck_memory_usage_add_pixbuf (usage, pixbufs, window->priv->hot->mini_icon);
+    }
 }
 
 static void
@@ -227,69 +290,93 @@ wnck_window_init (WnckWindow *window)
 {
   window->priv = WNCK_WINDOW_GET_PRIVATE (window);
 
+  window->priv->hot = g_slice_new0 (WnckWindowHot);
+  window->priv->hot->window = window;
+  window->priv->hot_detached = TRUE;
+
   window->priv->xwindow = None;
   window->priv->name = NULL;
   window->priv->app = NULL;
   window->priv->class_group = NULL;
   window->priv->group_leader = None;
-  window->priv->transient_for = None;
+  window->priv->hot->transient_for = None;
   window->priv->orig_event_mask = 0;
   window->priv->icon_geometry.width = -1; /* invalid cached value */
   window->priv->name = NULL;
   window->priv->icon_name = NULL;
+  window->priv->name_source = WNCK_NAME_SOURCE_NONE;
+  window->priv->icon_name_source = WNCK_NAME_SOURCE_NONE;
+  window->priv->name_changes = 0;
+  window->priv->icon_name_changes = 0;
   window->priv->session_id = NULL;
   window->priv->session_id_utf8 = NULL;
   window->priv->pid = 0;
-  window->priv->workspace = -1;
+  window->priv->hot->workspace = -1;
   window->priv->sort_order = G_MAXINT;
+  window->priv->hot->stack_position = -1;
+  window->priv->hot->monitor = -1;
+
+  window->priv->transient_attention = NULL;
+  window->priv->transient_attention_serial = 0;
 
   /* FIXME: should we have an invalid window type for this? */
-  window->priv->wintype = 0;
+  window->priv->hot->wintype = 0;
 
-  window->priv->icon = NULL;
-  window->priv->mini_icon = NULL;
+  window->priv->hot->icon = NULL;
+  window->priv->hot->mini_icon = NULL;
 
   window->priv->icon_cache = _wnck_icon_cache_new ();
 
   window->priv->actions = 0;
 
-  window->priv->x = 0;
-  window->priv->y = 0;
-  window->priv->width = 0;
-  window->priv->height = 0;
+  window->priv->hot->x = 0;
+  window->priv->hot->y = 0;
+  window->priv->hot->width = 0;
+  window->priv->hot->height = 0;
 
   window->priv->left_frame = 0;
   window->priv->right_frame = 0;
   window->priv->top_frame = 0;
   window->priv->bottom_frame = 0;
 
+  window->priv->frame = None;
+  window->priv->frame_x = 0;
+  window->priv->frame_y = 0;
+  window->priv->frame_parent_x = 0;
+  window->priv->frame_parent_y = 0;
+  window->priv->x_in_frame = 0;
+  window->priv->y_in_frame = 0;
+
   window->priv->startup_id = NULL;
 
   window->priv->res_class = NULL;
   window->priv->res_name = NULL;
 
-  window->priv->transient_for_root = FALSE;
-
-  window->priv->is_minimized = FALSE;
-  window->priv->is_maximized_horz = FALSE;
-  window->priv->is_maximized_vert = FALSE;
-  window->priv->is_shaded = FALSE;
-  window->priv->is_above = FALSE;
-  window->priv->is_below = FALSE;
-  window->priv->skip_pager = FALSE;
-  window->priv->skip_taskbar = FALSE;
-  window->priv->is_sticky = FALSE;
-  window->priv->is_hidden = FALSE;
-  window->priv->is_fullscreen = FALSE;
-  window->priv->demands_attention = FALSE;
-  window->priv->is_urgent = FALSE;
+  window->priv->hot->transient_for_root = FALSE;
+
+  window->priv->hot->is_minimized = FALSE;
+  window->priv->hot->is_maximized_horz = FALSE;
+  window->priv->hot->is_maximized_vert = FALSE;
+  window->priv->hot->is_shaded = FALSE;
+  window->priv->hot->is_above = FALSE;
+  window->priv->hot->is_below = FALSE;
+  window->priv->hot->skip_pager = FALSE;
+  window->priv->hot->skip_taskbar = FALSE;
+  window->priv->hot->is_sticky = FALSE;
+  window->priv->hot->is_hidden = FALSE;
+  window->priv->hot->is_fullscreen = FALSE;
+  window->priv->hot->demands_attention = FALSE;
+  window->priv->hot->is_urgent = FALSE;
 
   window->priv->needs_attention_time = 0;
 
   window->priv->net_wm_state_hidden = FALSE;
   window->priv->wm_state_iconic = FALSE;
 
-  window->priv->update_handler = 0;
+  window->priv->frame_is_toplevel = TRUE;
+
+  window->priv->update_queued = FALSE;
+  window->priv->in_dirty_queue = FALSE;
 
   window->priv->need_update_name = FALSE;
   window->priv->need_update_state = FALSE;
@@ -419,6 +506,25 @@ wnck_window_class_init (WnckWindowClass *klass)
                   NULL, NULL,
                   g_cclosure_marshal_VOID__VOID,
                   G_TYPE_NONE, 0);
+
+  /**
+   * WnckWindow::monitor-changed:
+   * @window: the #WnckWindow which emitted the signal.
+   *
+   * Emitted when the center of @window moves to another monitor, or when
+   * the monitors of the screen change so that @window is on another one.
+   * This is emitted far less often than #WnckWindow::geometry-changed.
+   *
+   * Since: 3.4
+   */
+  signals[MONITOR_CHANGED] =
+    g_signal_new ("monitor_changed",
+                  G_OBJECT_CLASS_TYPE (object_class),
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (WnckWindowClass, monitor_changed),
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
 }
 
 static void
@@ -447,29 +553,34 @@ wnck_window_finalize (GObject *object)
   window->priv->name = NULL;
   g_free (window->priv->icon_name);
   window->priv->icon_name = NULL;
-  g_free (window->priv->session_id);
+  _wnck_intern_release (window->priv->session_id);
   window->priv->session_id = NULL;
-  g_free (window->priv->session_id_utf8);
+  _wnck_intern_release (window->priv->session_id_utf8);
   window->priv->session_id_utf8 = NULL;
 
-  if (window->priv->icon)
-    g_object_unref (G_OBJECT (window->priv->icon));
-  window->priv->icon = NULL;
+  if (window->priv->hot->icon)
+    g_object_unref (G_OBJECT (window->priv->hot->icon));
+  window->priv->hot->icon = NULL;
 
-  if (window->priv->mini_icon)
-    g_object_unref (G_OBJECT (window->priv->mini_icon));
-  window->priv->mini_icon = NULL;
+  if (window->priv->hot->mini_icon)
+    g_object_unref (G_OBJECT (window->priv->hot->mini_icon));
+  window->priv->hot->mini_icon = NULL;
 
   _wnck_icon_cache_free (window->priv->icon_cache);
   window->priv->icon_cache = NULL;
 
-  g_free (window->priv->startup_id);
+  _wnck_intern_release (window->priv->startup_id);
   window->priv->startup_id = NULL;
-  g_free (window->priv->res_class);
+  _wnck_intern_release (window->priv->res_class);
   window->priv->res_class = NULL;
-  g_free (window->priv->res_name);
+  _wnck_intern_release (window->priv->res_name);
   window->priv->res_name = NULL;
 
+  /* a record still owned by the screen goes away with the screen */
+  if (window->priv->hot_detached)
+    g_slice_free (WnckWindowHot, window->priv->hot);
+  window->priv->hot = NULL;
+
   window->priv->xwindow = None;
 
   G_OBJECT_CLASS (wnck_window_parent_class)->finalize (object);
@@ -517,8 +628,9 @@ _wnck_window_create (Window      xwindow,
                      WnckScreen *screen,
                      gint        sort_order)
 {
-  WnckWindow *window;
-  Screen     *xscreen;
+  WnckWindow    *window;
+  WnckWindowHot *hot;
+  Screen        *xscreen;
 
   if (window_hash == NULL)
     window_hash = g_hash_table_new_full (_wnck_xid_hash, _wnck_xid_equal,
@@ -533,6 +645,12 @@ _wnck_window_create (Window      xwindow,
   window->priv->xwindow = xwindow;
   window->priv->screen = screen;
 
+  hot = _wnck_screen_alloc_window_hot (screen);
+  *hot = *window->priv->hot;
+  g_slice_free (WnckWindowHot, window->priv->hot);
+  window->priv->hot = hot;
+  window->priv->hot_detached = FALSE;
+
   g_hash_table_insert (window_hash, &window->priv->xwindow, window);
 
   /* Hash now owns one ref, caller gets none */
@@ -552,27 +670,26 @@ _wnck_window_create (Window      xwindow,
   window->priv->group_leader = window->priv->xwindow;
 
   window->priv->session_id =
-    _wnck_get_session_id (xscreen, window->priv->xwindow);
+    _wnck_intern_string_take (_wnck_get_session_id (xscreen,
+                                                    window->priv->xwindow));
 
   window->priv->pid =
     _wnck_get_pid (xscreen, window->priv->xwindow);
 
-  window->priv->x = 0;
-  window->priv->y = 0;
-  window->priv->width = 0;
-  window->priv->height = 0;
-  _wnck_get_window_geometry (xscreen,
-			     xwindow,
-                             &window->priv->x,
-                             &window->priv->y,
-                             &window->priv->width,
-                             &window->priv->height);
+  window->priv->hot->x = 0;
+  window->priv->hot->y = 0;
+  window->priv->hot->width = 0;
+  window->priv->hot->height = 0;
+  update_frame_tree (window);
+  _wnck_screen_update_window_monitor (screen, window);
 
   window->priv->sort_order = sort_order;
 
   window->priv->need_update_name = TRUE;
+  window->priv->name_changes = WNCK_NAME_SOURCE_ALL;
   window->priv->need_update_state = TRUE;
   window->priv->need_update_icon_name = TRUE;
+  window->priv->icon_name_changes = WNCK_NAME_SOURCE_ALL;
   window->priv->need_update_wm_state = TRUE;
   window->priv->need_update_workspace = TRUE;
   window->priv->need_update_actions = TRUE;
@@ -593,11 +710,25 @@ void
 _wnck_window_destroy (WnckWindow *window)
 {
   Window xwindow = window->priv->xwindow;
+  WnckWindowHot *hot;
 
   g_return_if_fail (WNCK_IS_WINDOW (window));
 
   g_return_if_fail (wnck_window_get (xwindow) == window);
 
+  _wnck_screen_forget_window_changes (window->priv->screen, window);
+  unqueue_update (window);
+  _wnck_screen_set_transient_for (window->priv->screen, window,
+                                  window->priv->hot->transient_for, None);
+
+  unset_frame (window);
+
+  /* the window may outlive the screen if somebody holds a reference */
+  hot = g_slice_dup (WnckWindowHot, window->priv->hot);
+  _wnck_screen_free_window_hot (window->priv->screen, window->priv->hot);
+  window->priv->hot = hot;
+  window->priv->hot_detached = TRUE;
+
   g_hash_table_remove (window_hash, &xwindow);
 
   /* Removing from hash also removes the only ref WnckWindow had */
@@ -732,9 +863,9 @@ _wnck_window_get_name_for_display (WnckWindow *window,
 
   if (use_state_decorations)
     {
-      if (window->priv->is_shaded)
+      if (window->priv->hot->is_shaded)
         return g_strdup_printf ("=%s=", name);
-      else if (window->priv->is_minimized)
+      else if (window->priv->hot->is_minimized)
         return g_strdup_printf ("[%s]", name);
       else
         return g_strdup (name);
@@ -780,7 +911,7 @@ wnck_window_get_transient (WnckWindow *window)
 {
   g_return_val_if_fail (WNCK_IS_WINDOW (window), NULL);
 
-  return wnck_window_get (window->priv->transient_for);
+  return wnck_window_get (window->priv->hot->transient_for);
 }
 
 /**
@@ -878,7 +1009,7 @@ wnck_window_get_session_id_utf8 (WnckWindow *window)
       window->priv->session_id != NULL)
     {
       GString *str;
-      char *p;
+      const char *p;
 
       str = g_string_new ("");
 
@@ -889,7 +1020,8 @@ wnck_window_get_session_id_utf8 (WnckWindow *window)
           p = g_utf8_next_char (p);
         }
 
-      window->priv->session_id_utf8 = g_string_free (str, FALSE);
+      window->priv->session_id_utf8 =
+        _wnck_intern_string_take (g_string_free (str, FALSE));
     }
 
   return window->priv->session_id_utf8;
@@ -964,7 +1096,7 @@ wnck_window_get_window_type (WnckWindow *window)
   /* FIXME: should we have an invalid window type for this? */
   g_return_val_if_fail (WNCK_IS_WINDOW (window), 0);
 
-  return window->priv->wintype;
+  return window->priv->hot->wintype;
 }
 
 /**
@@ -1023,7 +1155,7 @@ wnck_window_set_window_type (WnckWindow *window, WnckWindowType wintype)
 		   XA_ATOM, 32, PropModeReplace,
 		   (guchar *)&atom, 1);
 
-  _wnck_error_trap_pop (display);
+  _wnck_error_trap_pop_request (display);
 }
 
 /**
@@ -1040,7 +1172,7 @@ wnck_window_is_minimized (WnckWindow *window)
 {
   g_return_val_if_fail (WNCK_IS_WINDOW (window), FALSE);
 
-  return window->priv->is_minimized;
+  return window->priv->hot->is_minimized;
 }
 
 /**
@@ -1062,7 +1194,7 @@ wnck_window_needs_attention (WnckWindow *window)
 {
   g_return_val_if_fail (WNCK_IS_WINDOW (window), FALSE);
 
-  return window->priv->demands_attention || window->priv->is_urgent;
+  return window->priv->hot->demands_attention || window->priv->hot->is_urgent;
 }
 
 time_t
@@ -1077,26 +1209,40 @@ _wnck_window_get_needs_attention_time (WnckWindow *window)
 static WnckWindow *
 transient_needs_attention (WnckWindow *window)
 {
-  GList *windows;
   WnckWindow *transient;
+  WnckWindow *retval;
+  guint serial;
 
   if (!WNCK_IS_WINDOW (window))
     return NULL;
 
-  windows = wnck_screen_get_windows_stacked (window->priv->screen);
+  /* this is called for every window when the tasklist updates its lists,
+   * so the result is kept until a transient, the stacking, or the state or
+   * type of a window changes */
+  serial = _wnck_screen_get_transients_serial (window->priv->screen);
+  if (window->priv->transient_attention_serial == serial)
+    return window->priv->transient_attention;
+
+  retval = NULL;
 
   transient = window;
-  while ((transient = find_last_transient_for (windows, transient->priv->xwindow)))
+  while ((transient = find_last_transient_for (transient)))
     {
       /* catch transient cycles */
       if (transient == window)
-        return NULL;
+        break;
 
       if (wnck_window_needs_attention (transient))
-        return transient;
+        {
+          retval = transient;
+          break;
+        }
     }
 
-  return FALSE;
+  window->priv->transient_attention = retval;
+  window->priv->transient_attention_serial = serial;
+
+  return retval;
 }
 
 time_t
@@ -1151,7 +1297,7 @@ wnck_window_is_maximized_horizontally (WnckWindow *window)
 {
   g_return_val_if_fail (WNCK_IS_WINDOW (window), FALSE);
 
-  return window->priv->is_maximized_horz;
+  return window->priv->hot->is_maximized_horz;
 }
 
 /**
@@ -1168,7 +1314,7 @@ wnck_window_is_maximized_vertically   (WnckWindow *window)
 {
   g_return_val_if_fail (WNCK_IS_WINDOW (window), FALSE);
 
-  return window->priv->is_maximized_vert;
+  return window->priv->hot->is_maximized_vert;
 }
 
 const char*
@@ -1258,8 +1404,8 @@ wnck_window_is_maximized (WnckWindow *window)
   g_return_val_if_fail (WNCK_IS_WINDOW (window), FALSE);
 
   return
-    window->priv->is_maximized_horz &&
-    window->priv->is_maximized_vert;
+    window->priv->hot->is_maximized_horz &&
+    window->priv->hot->is_maximized_vert;
 }
 
 /**
@@ -1276,7 +1422,7 @@ wnck_window_is_shaded                 (WnckWindow *window)
 {
   g_return_val_if_fail (WNCK_IS_WINDOW (window), FALSE);
 
-  return window->priv->is_shaded;
+  return window->priv->hot->is_shaded;
 }
 
 /**
@@ -1297,7 +1443,7 @@ wnck_window_is_above                  (WnckWindow *window)
 {
   g_return_val_if_fail (WNCK_IS_WINDOW (window), FALSE);
 
-  return window->priv->is_above;
+  return window->priv->hot->is_above;
 }
 
 /**
@@ -1318,7 +1464,7 @@ wnck_window_is_below                  (WnckWindow *window)
 {
   g_return_val_if_fail (WNCK_IS_WINDOW (window), FALSE);
 
-  return window->priv->is_below;
+  return window->priv->hot->is_below;
 }
 
 /**
@@ -1335,7 +1481,7 @@ wnck_window_is_skip_pager             (WnckWindow *window)
 {
   g_return_val_if_fail (WNCK_IS_WINDOW (window), FALSE);
 
-  return window->priv->skip_pager;
+  return window->priv->hot->skip_pager;
 }
 
 /**
@@ -1371,7 +1517,7 @@ wnck_window_is_skip_tasklist          (WnckWindow *window)
 {
   g_return_val_if_fail (WNCK_IS_WINDOW (window), FALSE);
 
-  return window->priv->skip_taskbar;
+  return window->priv->hot->skip_taskbar;
 }
 
 /**
@@ -1390,7 +1536,7 @@ wnck_window_is_fullscreen                 (WnckWindow *window)
 {
   g_return_val_if_fail (WNCK_IS_WINDOW (window), FALSE);
 
-  return window->priv->is_fullscreen;
+  return window->priv->hot->is_fullscreen;
 }
 
 /**
@@ -1454,7 +1600,7 @@ wnck_window_is_sticky                 (WnckWindow *window)
 {
   g_return_val_if_fail (WNCK_IS_WINDOW (window), FALSE);
 
-  return window->priv->is_sticky;
+  return window->priv->hot->is_sticky;
 }
 
 /**
@@ -1825,10 +1971,10 @@ wnck_window_get_workspace (WnckWindow *window)
 {
   g_return_val_if_fail (WNCK_IS_WINDOW (window), NULL);
 
-  if (window->priv->workspace == ALL_WORKSPACES)
+  if (window->priv->hot->workspace == ALL_WORKSPACES)
     return NULL;
   else
-    return wnck_screen_get_workspace (window->priv->screen, window->priv->workspace);
+    return wnck_screen_get_workspace (window->priv->screen, window->priv->hot->workspace);
 }
 
 /**
@@ -1866,7 +2012,7 @@ wnck_window_is_pinned (WnckWindow *window)
 {
   g_return_val_if_fail (WNCK_IS_WINDOW (window), FALSE);
 
-  return window->priv->workspace == ALL_WORKSPACES;
+  return window->priv->hot->workspace == ALL_WORKSPACES;
 }
 
 /**
@@ -1902,7 +2048,7 @@ wnck_window_unpin (WnckWindow *window)
 
   g_return_if_fail (WNCK_IS_WINDOW (window));
 
-  if (window->priv->workspace != ALL_WORKSPACES)
+  if (window->priv->hot->workspace != ALL_WORKSPACES)
     return;
 
   active = wnck_screen_get_active_workspace (window->priv->screen);
@@ -1994,23 +2140,25 @@ wnck_window_is_most_recently_activated (WnckWindow *window)
 }
 
 static WnckWindow*
-find_last_transient_for (GList *windows,
-                         Window xwindow)
+find_last_transient_for (WnckWindow *window)
 {
   GList *tmp;
   WnckWindow *retval;
 
-  /* find _last_ transient for xwindow in the list */
+  /* find the topmost stacked transient for window */
 
   retval = NULL;
 
-  tmp = windows;
+  tmp = _wnck_screen_get_transients (window->priv->screen,
+                                     window->priv->xwindow);
   while (tmp != NULL)
     {
       WnckWindow *w = tmp->data;
 
-      if (w->priv->transient_for == xwindow &&
-	  w->priv->wintype != WNCK_WINDOW_UTILITY)
+      if (w->priv->hot->stack_position >= 0 &&
+	  w->priv->hot->wintype != WNCK_WINDOW_UTILITY &&
+          (retval == NULL ||
+           w->priv->hot->stack_position > retval->priv->hot->stack_position))
         retval = w;
 
       tmp = tmp->next;
@@ -2041,16 +2189,13 @@ void
 wnck_window_activate_transient (WnckWindow *window,
                                 guint32     timestamp)
 {
-  GList *windows;
   WnckWindow *transient;
   WnckWindow *next;
 
   g_return_if_fail (WNCK_IS_WINDOW (window));
 
-  windows = wnck_screen_get_windows_stacked (window->priv->screen);
-
   transient = NULL;
-  next = find_last_transient_for (windows, window->priv->xwindow);
+  next = find_last_transient_for (window);
 
   while (next != NULL)
     {
@@ -2063,7 +2208,7 @@ wnck_window_activate_transient (WnckWindow *window,
 
       transient = next;
 
-      next = find_last_transient_for (windows, transient->priv->xwindow);
+      next = find_last_transient_for (transient);
     }
 
   if (transient != NULL)
@@ -2095,15 +2240,12 @@ wnck_window_activate_transient (WnckWindow *window,
 gboolean
 wnck_window_transient_is_most_recently_activated (WnckWindow *window)
 {
-  GList *windows;
   WnckWindow *transient;
 
   g_return_val_if_fail (WNCK_IS_WINDOW (window), FALSE);
 
-  windows = wnck_screen_get_windows_stacked (window->priv->screen);
-
   transient = window;
-  while ((transient = find_last_transient_for (windows, transient->priv->xwindow)))
+  while ((transient = find_last_transient_for (transient)))
     {
       /* catch transient cycles */
       if (transient == window)
@@ -2136,18 +2278,18 @@ get_icons (WnckWindow *window)
     {
       window->priv->need_emit_icon_changed = TRUE;
 
-      if (window->priv->icon)
-        g_object_unref (G_OBJECT (window->priv->icon));
+      if (window->priv->hot->icon)
+        g_object_unref (G_OBJECT (window->priv->hot->icon));
 
-      if (window->priv->mini_icon)
-        g_object_unref (G_OBJECT (window->priv->mini_icon));
+      if (window->priv->hot->mini_icon)
+        g_object_unref (G_OBJECT (window->priv->hot->mini_icon));
 
-      window->priv->icon = icon;
-      window->priv->mini_icon = mini_icon;
+      window->priv->hot->icon = icon;
+      window->priv->hot->mini_icon = mini_icon;
     }
 
-  g_assert ((window->priv->icon && window->priv->mini_icon) ||
-            !(window->priv->icon || window->priv->mini_icon));
+  g_assert ((window->priv->hot->icon && window->priv->hot->mini_icon) ||
+            !(window->priv->hot->icon || window->priv->hot->mini_icon));
 }
 
 /**
@@ -2173,7 +2315,7 @@ wnck_window_get_icon (WnckWindow *window)
                             * the update
                             */
 
-  return window->priv->icon;
+  return window->priv->hot->icon;
 }
 
 /**
@@ -2199,7 +2341,7 @@ wnck_window_get_mini_icon (WnckWindow *window)
                             * the update
                             */
 
-  return window->priv->mini_icon;
+  return window->priv->hot->mini_icon;
 }
 
 /**
@@ -2281,13 +2423,34 @@ wnck_window_get_client_window_geometry (WnckWindow *window,
   g_return_if_fail (WNCK_IS_WINDOW (window));
 
   if (xp)
-    *xp = window->priv->x;
+    *xp = window->priv->hot->x;
   if (yp)
-    *yp = window->priv->y;
+    *yp = window->priv->hot->y;
   if (widthp)
-    *widthp = window->priv->width;
+    *widthp = window->priv->hot->width;
   if (heightp)
-    *heightp = window->priv->height;
+    *heightp = window->priv->hot->height;
+}
+
+/**
+ * wnck_window_get_monitor:
+ * @window: a #WnckWindow.
+ *
+ * Gets the number of the monitor of the screen of @window that contains the
+ * center of @window, as used by #GdkScreen. This is kept up to date by the
+ * #WnckScreen of @window and does not query GDK, so it is cheap to call for
+ * many windows. See #WnckWindow::monitor-changed.
+ *
+ * Return value: the monitor number of @window, or -1 if it is not known.
+ *
+ * Since: 3.4
+ **/
+int
+wnck_window_get_monitor (WnckWindow *window)
+{
+  g_return_val_if_fail (WNCK_IS_WINDOW (window), -1);
+
+  return window->priv->hot->monitor;
 }
 
 /**
@@ -2318,13 +2481,13 @@ wnck_window_get_geometry (WnckWindow *window,
   g_return_if_fail (WNCK_IS_WINDOW (window));
 
   if (xp)
-    *xp = window->priv->x - window->priv->left_frame;
+    *xp = window->priv->hot->x - window->priv->left_frame;
   if (yp)
-    *yp = window->priv->y - window->priv->top_frame;
+    *yp = window->priv->hot->y - window->priv->top_frame;
   if (widthp)
-    *widthp = window->priv->width + window->priv->left_frame + window->priv->right_frame;
+    *widthp = window->priv->hot->width + window->priv->left_frame + window->priv->right_frame;
   if (heightp)
-    *heightp = window->priv->height + window->priv->top_frame + window->priv->bottom_frame;
+    *heightp = window->priv->hot->height + window->priv->top_frame + window->priv->bottom_frame;
 }
 
 /**
@@ -2495,10 +2658,10 @@ wnck_window_is_in_viewport (WnckWindow    *window,
   viewport_rect.width = wnck_screen_get_width (window->priv->screen);
   viewport_rect.height = wnck_screen_get_height (window->priv->screen);
 
-  window_rect.x = window->priv->x - window->priv->left_frame + viewport_rect.x;
-  window_rect.y = window->priv->y - window->priv->top_frame + viewport_rect.y;
-  window_rect.width = window->priv->width + window->priv->left_frame + window->priv->right_frame;
-  window_rect.height = window->priv->height + window->priv->top_frame + window->priv->bottom_frame;
+  window_rect.x = window->priv->hot->x - window->priv->left_frame + viewport_rect.x;
+  window_rect.y = window->priv->hot->y - window->priv->top_frame + viewport_rect.y;
+  window_rect.width = window->priv->hot->width + window->priv->left_frame + window->priv->right_frame;
+  window_rect.height = window->priv->hot->height + window->priv->top_frame + window->priv->bottom_frame;
 
   return gdk_rectangle_intersect (&viewport_rect, &window_rect, &window_rect);
 }
@@ -2554,6 +2717,8 @@ _wnck_window_process_property_notify (WnckWindow *window,
            xevent->xproperty.atom ==
            _wnck_atom_get ("_NET_WM_VISIBLE_NAME"))
     {
+      window->priv->name_changes |=
+        1 << _wnck_name_source_for_atom (xevent->xproperty.atom);
       window->priv->need_update_name = TRUE;
       queue_update (window);
     }
@@ -2564,6 +2729,8 @@ _wnck_window_process_property_notify (WnckWindow *window,
            xevent->xproperty.atom ==
            _wnck_atom_get ("_NET_WM_VISIBLE_ICON_NAME"))
     {
+      window->priv->icon_name_changes |=
+        1 << _wnck_name_source_for_atom (xevent->xproperty.atom);
       window->priv->need_update_icon_name = TRUE;
       queue_update (window);
     }
@@ -2626,29 +2793,305 @@ _wnck_window_process_property_notify (WnckWindow *window,
     }
 }
 
+static void
+free_frame_clients (gpointer data)
+{
+  FrameClients *clients = data;
+
+  g_slist_free (clients->windows);
+  g_slice_free (FrameClients, clients);
+}
+
+/* Removes window from the clients of its frame, and returns TRUE if it was
+ * the last one.
+ */
+static gboolean
+remove_frame_client (WnckWindow *window)
+{
+  FrameClients *clients;
+
+  clients = g_hash_table_lookup (frame_hash, &window->priv->frame);
+  if (clients == NULL)
+    return TRUE;
+
+  clients->windows = g_slist_remove (clients->windows, window);
+  if (clients->windows != NULL)
+    return FALSE;
+
+  g_hash_table_remove (frame_hash, &window->priv->frame);
+
+  return TRUE;
+}
+
+/* Gets the position of xwindow in the frame (and of the frame) and starts
+ * tracking ConfigureNotify on the frame. This is only needed when the window
+ * is created and when it is reparented.
+ */
+static void
+update_frame_tree (WnckWindow *window)
+{
+  Window old_frame;
+  Window frame;
+  gboolean frame_is_toplevel;
+
+  /* the old frame stops being tracked only if it has no other client */
+  old_frame = None;
+  if (window->priv->frame != None)
+    {
+      if (remove_frame_client (window))
+        old_frame = window->priv->frame;
+      window->priv->frame = None;
+    }
+
+  frame = None;
+  _wnck_get_window_tree_geometry (WNCK_SCREEN_XSCREEN (window->priv->screen),
+                                  window->priv->xwindow,
+                                  old_frame,
+                                  StructureNotifyMask,
+                                  &frame,
+                                  &window->priv->x_in_frame,
+                                  &window->priv->y_in_frame,
+                                  &window->priv->frame_x,
+                                  &window->priv->frame_y,
+                                  &window->priv->frame_parent_x,
+                                  &window->priv->frame_parent_y,
+                                  &frame_is_toplevel,
+                                  &window->priv->hot->width,
+                                  &window->priv->hot->height);
+
+  window->priv->frame_is_toplevel = frame_is_toplevel;
+
+  if (frame != None)
+    {
+      FrameClients *clients;
+
+      if (frame_hash == NULL)
+        frame_hash = g_hash_table_new_full (_wnck_xid_hash, _wnck_xid_equal,
+                                            NULL, free_frame_clients);
+
+      clients = g_hash_table_lookup (frame_hash, &frame);
+      if (clients == NULL)
+        {
+          clients = g_slice_new (FrameClients);
+          clients->frame = frame;
+          clients->windows = NULL;
+          g_hash_table_insert (frame_hash, &clients->frame, clients);
+        }
+
+      clients->windows = g_slist_prepend (clients->windows, window);
+      window->priv->frame = frame;
+    }
+
+  window->priv->hot->x = window->priv->frame_x + window->priv->x_in_frame;
+  window->priv->hot->y = window->priv->frame_y + window->priv->y_in_frame;
+}
+
+static void
+unset_frame (WnckWindow *window)
+{
+  if (window->priv->frame == None)
+    return;
+
+  if (remove_frame_client (window))
+    _wnck_select_input (WNCK_SCREEN_XSCREEN (window->priv->screen),
+                        window->priv->frame,
+                        NoEventMask,
+                        FALSE);
+
+  window->priv->frame = None;
+}
+
+void
+_wnck_window_set_stack_position (WnckWindow *window,
+                                 int         position)
+{
+  g_return_if_fail (WNCK_IS_WINDOW (window));
+
+  window->priv->hot->stack_position = position;
+}
+
+void
+_wnck_window_set_listed (WnckWindow *window,
+                         gboolean    listed)
+{
+  g_return_if_fail (WNCK_IS_WINDOW (window));
+
+  window->priv->hot->listed = listed != FALSE;
+}
+
+void
+_wnck_window_set_monitor (WnckWindow *window,
+                          int         monitor)
+{
+  int old_monitor;
+
+  g_return_if_fail (WNCK_IS_WINDOW (window));
+
+  old_monitor = window->priv->hot->monitor;
+  if (old_monitor == monitor)
+    return;
+
+  window->priv->hot->monitor = monitor;
+
+  /* the first assignment is part of the initial state of the window */
+  if (old_monitor != -1)
+    emit_monitor_changed (window);
+}
+
+/* The record of @window that the scans over all windows of the screen
+ * read; it is owned by @window.
+ */
+const WnckWindowHot*
+_wnck_window_get_hot (WnckWindow *window)
+{
+  g_return_val_if_fail (WNCK_IS_WINDOW (window), NULL);
+
+  return window->priv->hot;
+}
+
+/* The window @window is transient for, even if libwnck has no WnckWindow
+ * for it yet; None if there is none, or if it is the root window.
+ */
+Window
+_wnck_window_get_transient_for_xid (WnckWindow *window)
+{
+  g_return_val_if_fail (WNCK_IS_WINDOW (window), None);
+
+  if (window->priv->hot->transient_for_root)
+    return None;
+
+  return window->priv->hot->transient_for;
+}
+
+/* Returns a new list of the windows in frame, to be freed with
+ * g_slist_free(); the windows are not referenced.
+ */
+GSList*
+_wnck_window_get_for_frame (Window frame)
+{
+  FrameClients *clients;
+
+  if (frame_hash == NULL)
+    return NULL;
+
+  clients = g_hash_table_lookup (frame_hash, &frame);
+  if (clients == NULL)
+    return NULL;
+
+  return g_slist_copy (clients->windows);
+}
+
+/* Used when the frame is nested in other windows of the window manager */
+static void
+update_position_from_server (WnckWindow *window)
+{
+  _wnck_get_window_position (WNCK_SCREEN_XSCREEN (window->priv->screen),
+                             window->priv->xwindow,
+                             &window->priv->hot->x,
+                             &window->priv->hot->y);
+
+  window->priv->frame_x = window->priv->hot->x - window->priv->x_in_frame;
+  window->priv->frame_y = window->priv->hot->y - window->priv->y_in_frame;
+}
+
 void
 _wnck_window_process_configure_notify (WnckWindow *window,
                                        XEvent     *xevent)
 {
   if (xevent->xconfigure.send_event)
     {
-      window->priv->x = xevent->xconfigure.x;
-      window->priv->y = xevent->xconfigure.y;
+      /* Synthetic events from the window manager are root-relative */
+      window->priv->hot->x = xevent->xconfigure.x;
+      window->priv->hot->y = xevent->xconfigure.y;
+      window->priv->x_in_frame = window->priv->hot->x - window->priv->frame_x;
+      window->priv->y_in_frame = window->priv->hot->y - window->priv->frame_y;
+    }
+  else
+    {
+      window->priv->x_in_frame = xevent->xconfigure.x +
+                                 xevent->xconfigure.border_width;
+      window->priv->y_in_frame = xevent->xconfigure.y +
+                                 xevent->xconfigure.border_width;
+
+      if (window->priv->frame_is_toplevel)
+        {
+          window->priv->hot->x = window->priv->frame_x +
+                                 window->priv->x_in_frame;
+          window->priv->hot->y = window->priv->frame_y +
+                                 window->priv->y_in_frame;
+        }
+      else
+        update_position_from_server (window);
+    }
+
+  window->priv->hot->width = xevent->xconfigure.width;
+  window->priv->hot->height = xevent->xconfigure.height;
+
+  emit_geometry_changed (window);
+}
+
+void
+_wnck_window_process_frame_configure_notify (WnckWindow *window,
+                                             XEvent     *xevent)
+{
+  int frame_x, frame_y;
+
+  if (!window->priv->frame_is_toplevel)
+    {
+      int old_x, old_y;
+
+      old_x = window->priv->hot->x;
+      old_y = window->priv->hot->y;
+
+      update_position_from_server (window);
+
+      if (old_x != window->priv->hot->x || old_y != window->priv->hot->y)
+        emit_geometry_changed (window);
+
+      return;
+    }
+
+  if (xevent->xconfigure.send_event)
+    {
+      frame_x = xevent->xconfigure.x + xevent->xconfigure.border_width;
+      frame_y = xevent->xconfigure.y + xevent->xconfigure.border_width;
     }
   else
     {
-      _wnck_get_window_position (WNCK_SCREEN_XSCREEN (window->priv->screen),
-				 window->priv->xwindow,
-                                 &window->priv->x,
-                                 &window->priv->y);
+      /* the parent of a frame is not expected to move */
+      frame_x = window->priv->frame_parent_x +
+                xevent->xconfigure.x + xevent->xconfigure.border_width;
+      frame_y = window->priv->frame_parent_y +
+                xevent->xconfigure.y + xevent->xconfigure.border_width;
     }
 
-  window->priv->width = xevent->xconfigure.width;
-  window->priv->height = xevent->xconfigure.height;
+  if (frame_x == window->priv->frame_x &&
+      frame_y == window->priv->frame_y)
+    return;
+
+  window->priv->frame_x = frame_x;
+  window->priv->frame_y = frame_y;
+  window->priv->hot->x = frame_x + window->priv->x_in_frame;
+  window->priv->hot->y = frame_y + window->priv->y_in_frame;
 
   emit_geometry_changed (window);
 }
 
+void
+_wnck_window_process_reparent_notify (WnckWindow *window,
+                                      XEvent     *xevent)
+{
+  int old_x, old_y;
+
+  old_x = window->priv->hot->x;
+  old_y = window->priv->hot->y;
+
+  update_frame_tree (window);
+
+  if (old_x != window->priv->hot->x || old_y != window->priv->hot->y)
+    emit_geometry_changed (window);
+}
+
 static void
 update_wm_state (WnckWindow *window)
 {
@@ -2691,19 +3134,19 @@ update_state (WnckWindow *window)
     {
       gboolean demanded_attention;
 
-      demanded_attention = window->priv->demands_attention;
+      demanded_attention = window->priv->hot->demands_attention;
 
-      window->priv->is_maximized_horz = FALSE;
-      window->priv->is_maximized_vert = FALSE;
-      window->priv->is_sticky = FALSE;
-      window->priv->is_shaded = FALSE;
-      window->priv->is_above = FALSE;
-      window->priv->is_below = FALSE;
-      window->priv->skip_taskbar = FALSE;
-      window->priv->skip_pager = FALSE;
+      window->priv->hot->is_maximized_horz = FALSE;
+      window->priv->hot->is_maximized_vert = FALSE;
+      window->priv->hot->is_sticky = FALSE;
+      window->priv->hot->is_shaded = FALSE;
+      window->priv->hot->is_above = FALSE;
+      window->priv->hot->is_below = FALSE;
+      window->priv->hot->skip_taskbar = FALSE;
+      window->priv->hot->skip_pager = FALSE;
       window->priv->net_wm_state_hidden = FALSE;
-      window->priv->is_fullscreen = FALSE;
-      window->priv->demands_attention = FALSE;
+      window->priv->hot->is_fullscreen = FALSE;
+      window->priv->hot->demands_attention = FALSE;
 
       atoms = NULL;
       n_atoms = 0;
@@ -2716,48 +3159,48 @@ update_state (WnckWindow *window)
       while (i < n_atoms)
         {
           if (atoms[i] == _wnck_atom_get ("_NET_WM_STATE_MAXIMIZED_VERT"))
-            window->priv->is_maximized_vert = TRUE;
+            window->priv->hot->is_maximized_vert = TRUE;
           else if (atoms[i] == _wnck_atom_get ("_NET_WM_STATE_MAXIMIZED_HORZ"))
-            window->priv->is_maximized_horz = TRUE;
+            window->priv->hot->is_maximized_horz = TRUE;
           else if (atoms[i] == _wnck_atom_get ("_NET_WM_STATE_HIDDEN"))
             window->priv->net_wm_state_hidden = TRUE;
           else if (atoms[i] == _wnck_atom_get ("_NET_WM_STATE_STICKY"))
-            window->priv->is_sticky = TRUE;
+            window->priv->hot->is_sticky = TRUE;
           else if (atoms[i] == _wnck_atom_get ("_NET_WM_STATE_SHADED"))
-            window->priv->is_shaded = TRUE;
+            window->priv->hot->is_shaded = TRUE;
           else if (atoms[i] == _wnck_atom_get ("_NET_WM_STATE_ABOVE"))
-            window->priv->is_above = TRUE;
+            window->priv->hot->is_above = TRUE;
           else if (atoms[i] == _wnck_atom_get ("_NET_WM_STATE_BELOW"))
-            window->priv->is_below = TRUE;
+            window->priv->hot->is_below = TRUE;
           else if (atoms[i] == _wnck_atom_get ("_NET_WM_STATE_FULLSCREEN"))
-            window->priv->is_fullscreen = TRUE;
+            window->priv->hot->is_fullscreen = TRUE;
           else if (atoms[i] == _wnck_atom_get ("_NET_WM_STATE_SKIP_TASKBAR"))
-            window->priv->skip_taskbar = TRUE;
+            window->priv->hot->skip_taskbar = TRUE;
           else if (atoms[i] == _wnck_atom_get ("_NET_WM_STATE_SKIP_PAGER"))
-            window->priv->skip_pager = TRUE;
+            window->priv->hot->skip_pager = TRUE;
           else if (atoms[i] == _wnck_atom_get ("_NET_WM_STATE_DEMANDS_ATTENTION"))
-            window->priv->demands_attention = TRUE;
+            window->priv->hot->demands_attention = TRUE;
 
           ++i;
         }
 
-      if (window->priv->demands_attention != demanded_attention)
+      if (window->priv->hot->demands_attention != demanded_attention)
         {
-          if (window->priv->demands_attention)
+          if (window->priv->hot->demands_attention)
             time (&window->priv->needs_attention_time);
-          else if (!window->priv->is_urgent)
+          else if (!window->priv->hot->is_urgent)
             window->priv->needs_attention_time = 0;
         }
 
       g_free (atoms);
     }
 
-  switch (window->priv->wintype)
+  switch (window->priv->hot->wintype)
     {
     case WNCK_WINDOW_DESKTOP:
     case WNCK_WINDOW_DOCK:
     case WNCK_WINDOW_SPLASHSCREEN:
-      window->priv->skip_taskbar = TRUE;
+      window->priv->hot->skip_taskbar = TRUE;
       break;
 
     case WNCK_WINDOW_TOOLBAR:
@@ -2768,8 +3211,8 @@ update_state (WnckWindow *window)
        * for some main application window
        */
       if (wnck_window_get_transient (window) != NULL &&
-          !window->priv->transient_for_root)
-        window->priv->skip_taskbar = TRUE;
+          !window->priv->hot->transient_for_root)
+        window->priv->hot->skip_taskbar = TRUE;
       break;
 
     case WNCK_WINDOW_NORMAL:
@@ -2779,14 +3222,14 @@ update_state (WnckWindow *window)
   /* FIXME!!!!!!!!!! What in the world is this buggy duplicate of the code
    * immediately above this for??!?!?
    */
-  switch (window->priv->wintype)
+  switch (window->priv->hot->wintype)
     {
     case WNCK_WINDOW_DESKTOP:
     case WNCK_WINDOW_DOCK:
     case WNCK_WINDOW_TOOLBAR:
     case WNCK_WINDOW_MENU:
     case WNCK_WINDOW_SPLASHSCREEN:
-      window->priv->skip_pager = TRUE;
+      window->priv->hot->skip_pager = TRUE;
       break;
 
     case WNCK_WINDOW_NORMAL:
@@ -2799,19 +3242,19 @@ update_state (WnckWindow *window)
   if (wnck_screen_net_wm_supports (window->priv->screen,
                                    "_NET_WM_STATE_HIDDEN"))
     {
-      window->priv->is_hidden = window->priv->net_wm_state_hidden;
+      window->priv->hot->is_hidden = window->priv->net_wm_state_hidden;
 
       /* FIXME this is really broken; need to bring it up on
        * wm-spec-list. It results in showing an "Unminimize" menu
        * item on task list, for shaded windows.
        */
-      window->priv->is_minimized = window->priv->is_hidden;
+      window->priv->hot->is_minimized = window->priv->hot->is_hidden;
     }
   else
     {
-      window->priv->is_minimized = window->priv->wm_state_iconic;
+      window->priv->hot->is_minimized = window->priv->wm_state_iconic;
 
-      window->priv->is_hidden = window->priv->is_minimized || window->priv->is_shaded;
+      window->priv->hot->is_hidden = window->priv->hot->is_minimized || window->priv->hot->is_shaded;
     }
 }
 
@@ -2819,14 +3262,20 @@ static void
 update_name (WnckWindow *window)
 {
   char *new_name;
+  guint changes;
 
   if (!window->priv->need_update_name)
     return;
 
   window->priv->need_update_name = FALSE;
 
-  new_name = _wnck_get_name (WNCK_SCREEN_XSCREEN (window->priv->screen),
-                             window->priv->xwindow);
+  changes = window->priv->name_changes;
+  window->priv->name_changes = 0;
+
+  if (!_wnck_read_name (WNCK_SCREEN_XSCREEN (window->priv->screen),
+                        window->priv->xwindow, FALSE, changes,
+                        &window->priv->name_source, &new_name))
+    return;
 
   if (g_strcmp0 (window->priv->name, new_name) != 0)
     window->priv->need_emit_name_changed = TRUE;
@@ -2839,14 +3288,20 @@ static void
 update_icon_name (WnckWindow *window)
 {
   char *new_name = NULL;
+  guint changes;
 
   if (!window->priv->need_update_icon_name)
     return;
 
   window->priv->need_update_icon_name = FALSE;
 
-  new_name = _wnck_get_icon_name (WNCK_SCREEN_XSCREEN (window->priv->screen),
-                                  window->priv->xwindow);
+  changes = window->priv->icon_name_changes;
+  window->priv->icon_name_changes = 0;
+
+  if (!_wnck_read_name (WNCK_SCREEN_XSCREEN (window->priv->screen),
+                        window->priv->xwindow, TRUE, changes,
+                        &window->priv->icon_name_source, &new_name))
+    return;
 
   if (g_strcmp0 (window->priv->icon_name, new_name) != 0)
     window->priv->need_emit_name_changed = TRUE;
@@ -2866,7 +3321,7 @@ update_workspace (WnckWindow *window)
 
   window->priv->need_update_workspace = FALSE;
 
-  old = window->priv->workspace;
+  old = window->priv->hot->workspace;
 
   val = ALL_WORKSPACES;
   _wnck_get_cardinal (WNCK_SCREEN_XSCREEN (window->priv->screen),
@@ -2874,9 +3329,9 @@ update_workspace (WnckWindow *window)
                       _wnck_atom_get ("_NET_WM_DESKTOP"),
                       &val);
 
-  window->priv->workspace = val;
+  window->priv->hot->workspace = val;
 
-  if (old != window->priv->workspace)
+  if (old != window->priv->hot->workspace)
     emit_workspace_changed (window);
 }
 
@@ -3047,7 +3502,7 @@ update_wintype (WnckWindow *window)
 
   if (!found_type)
     {
-      if (window->priv->transient_for != None)
+      if (window->priv->hot->transient_for != None)
         {
           type = WNCK_WINDOW_DIALOG;
         }
@@ -3058,19 +3513,27 @@ update_wintype (WnckWindow *window)
       found_type = TRUE;
     }
 
-  window->priv->wintype = type;
+  if (window->priv->hot->wintype != type)
+    {
+      window->priv->hot->wintype = type;
+      /* utility windows are skipped by find_last_transient_for() */
+      _wnck_screen_invalidate_transients (window->priv->screen);
+    }
 }
 
 static void
 update_transient_for (WnckWindow *window)
 {
   Window parent;
+  Window old_transient_for;
 
   if (!window->priv->need_update_transient_for)
     return;
 
   window->priv->need_update_transient_for = FALSE;
 
+  old_transient_for = window->priv->hot->transient_for;
+
   parent = None;
   if (_wnck_get_window (WNCK_SCREEN_XSCREEN (window->priv->screen),
                         window->priv->xwindow,
@@ -3078,18 +3541,22 @@ update_transient_for (WnckWindow *window)
                         &parent) &&
       parent != window->priv->xwindow)
     {
-      window->priv->transient_for = parent;
+      window->priv->hot->transient_for = parent;
 
-      if (wnck_screen_get_for_root (window->priv->transient_for) != NULL)
-        window->priv->transient_for_root = TRUE;
+      if (wnck_screen_get_for_root (window->priv->hot->transient_for) != NULL)
+        window->priv->hot->transient_for_root = TRUE;
       else
-        window->priv->transient_for_root = FALSE;
+        window->priv->hot->transient_for_root = FALSE;
     }
   else
     {
-      window->priv->transient_for = None;
-      window->priv->transient_for_root = FALSE;
+      window->priv->hot->transient_for = None;
+      window->priv->hot->transient_for_root = FALSE;
     }
+
+  _wnck_screen_set_transient_for (window->priv->screen, window,
+                                  old_transient_for,
+                                  window->priv->hot->transient_for);
 }
 
 static void
@@ -3100,31 +3567,33 @@ update_startup_id (WnckWindow *window)
 
   window->priv->need_update_startup_id = FALSE;
 
-  g_free (window->priv->startup_id);
+  _wnck_intern_release (window->priv->startup_id);
   window->priv->startup_id =
-    _wnck_get_utf8_property (WNCK_SCREEN_XSCREEN (window->priv->screen),
-                             window->priv->xwindow,
-                             _wnck_atom_get ("_NET_STARTUP_ID"));
+    _wnck_intern_string_take (_wnck_get_utf8_property (WNCK_SCREEN_XSCREEN (window->priv->screen),
+                                                       window->priv->xwindow,
+                                                       _wnck_atom_get ("_NET_STARTUP_ID")));
 }
 
 static void
 update_wmclass (WnckWindow *window)
 {
+  char *res_class;
+  char *res_name;
+
   if (!window->priv->need_update_wmclass)
     return;
 
   window->priv->need_update_wmclass = FALSE;
 
-  g_free (window->priv->res_class);
-  g_free (window->priv->res_name);
-
-  window->priv->res_class = NULL;
-  window->priv->res_name = NULL;
+  _wnck_intern_release (window->priv->res_class);
+  _wnck_intern_release (window->priv->res_name);
 
   _wnck_get_wmclass (WNCK_SCREEN_XSCREEN (window->priv->screen),
                      window->priv->xwindow,
-                     &window->priv->res_class,
-                     &window->priv->res_name);
+                     &res_class, &res_name);
+
+  window->priv->res_class = _wnck_intern_string_take (res_class);
+  window->priv->res_name = _wnck_intern_string_take (res_name);
 }
 
 static void
@@ -3154,13 +3623,13 @@ update_wmhints (WnckWindow *window)
 
       if (hints->flags & XUrgencyHint)
         {
-          window->priv->is_urgent = TRUE;
+          window->priv->hot->is_urgent = TRUE;
           time (&window->priv->needs_attention_time);
         }
       else
         {
-          window->priv->is_urgent = FALSE;
-          if (!window->priv->demands_attention)
+          window->priv->hot->is_urgent = FALSE;
+          if (!window->priv->hot->demands_attention)
             window->priv->needs_attention_time = 0;
         }
 
@@ -3207,6 +3676,7 @@ force_update_now (WnckWindow *window)
   WnckWindowState old_state;
   WnckWindowState new_state;
   WnckWindowActions old_actions;
+  gboolean old_needs_attention;
 
   unqueue_update (window);
 
@@ -3224,6 +3694,7 @@ force_update_now (WnckWindow *window)
 
   old_state = COMPRESS_STATE (window);
   old_actions = window->priv->actions;
+  old_needs_attention = wnck_window_needs_attention (window);
 
   update_startup_id (window);    /* no side effects */
   update_wmclass (window);
@@ -3242,6 +3713,9 @@ force_update_now (WnckWindow *window)
 
   new_state = COMPRESS_STATE (window);
 
+  if (wnck_window_needs_attention (window) != old_needs_attention)
+    _wnck_screen_invalidate_transients (window->priv->screen);
+
   if (old_state != new_state)
     emit_state_changed (window, old_state ^ new_state, new_state);
 
@@ -3254,42 +3728,54 @@ force_update_now (WnckWindow *window)
 }
 
 
-static gboolean
-update_idle (gpointer data)
-{
-  WnckWindow *window = WNCK_WINDOW (data);
-
-  window->priv->update_handler = 0;
-  force_update_now (window);
-  return FALSE;
-}
-
 static void
 queue_update (WnckWindow *window)
 {
-  if (window->priv->update_handler != 0)
+  if (window->priv->update_queued)
+    return;
+
+  window->priv->update_queued = TRUE;
+
+  if (window->priv->in_dirty_queue)
     return;
 
-  window->priv->update_handler = g_idle_add (update_idle, window);
+  window->priv->in_dirty_queue = TRUE;
+  _wnck_screen_queue_window_update (window->priv->screen, window);
 }
 
 static void
 unqueue_update (WnckWindow *window)
 {
-  if (window->priv->update_handler != 0)
-    {
-      g_source_remove (window->priv->update_handler);
-      window->priv->update_handler = 0;
-    }
+  /* the screen skips the windows whose update is not queued anymore */
+  window->priv->update_queued = FALSE;
+}
+
+void
+_wnck_window_process_queued_update (WnckWindow *window)
+{
+  g_return_if_fail (WNCK_IS_WINDOW (window));
+
+  /* the screen just took window out of its queue */
+  window->priv->in_dirty_queue = FALSE;
+
+  if (window->priv->update_queued)
+    force_update_now (window);
 }
 
 static void
 emit_name_changed (WnckWindow *window)
 {
+  gint64 start;
+
   window->priv->need_emit_name_changed = FALSE;
+
+  start = g_get_monotonic_time ();
   g_signal_emit (G_OBJECT (window),
                  signals[NAME_CHANGED],
                  0);
+  _wnck_screen_record_window_change (window->priv->screen, window,
+                                     WNCK_WINDOW_CHANGED_NAME,
+                                     g_get_monotonic_time () - start);
 }
 
 static void
@@ -3297,26 +3783,45 @@ emit_state_changed (WnckWindow     *window,
                     WnckWindowState changed_mask,
                     WnckWindowState new_state)
 {
+  gint64 start;
+
+  start = g_get_monotonic_time ();
   g_signal_emit (G_OBJECT (window),
                  signals[STATE_CHANGED],
                  0, changed_mask, new_state);
+  _wnck_screen_record_window_change (window->priv->screen, window,
+                                     WNCK_WINDOW_CHANGED_STATE,
+                                     g_get_monotonic_time () - start);
 }
 
 static void
 emit_workspace_changed (WnckWindow *window)
 {
+  gint64 start;
+
+  start = g_get_monotonic_time ();
   g_signal_emit (G_OBJECT (window),
                  signals[WORKSPACE_CHANGED],
                  0);
+  _wnck_screen_record_window_change (window->priv->screen, window,
+                                     WNCK_WINDOW_CHANGED_WORKSPACE,
+                                     g_get_monotonic_time () - start);
 }
 
 static void
 emit_icon_changed (WnckWindow *window)
 {
+  gint64 start;
+
   window->priv->need_emit_icon_changed = FALSE;
+
+  start = g_get_monotonic_time ();
   g_signal_emit (G_OBJECT (window),
                  signals[ICON_CHANGED],
                  0);
+  _wnck_screen_record_window_change (window->priv->screen, window,
+                                     WNCK_WINDOW_CHANGED_ICON,
+                                     g_get_monotonic_time () - start);
 }
 
 static void
@@ -3324,15 +3829,43 @@ emit_actions_changed   (WnckWindow       *window,
                         WnckWindowActions changed_mask,
                         WnckWindowActions new_actions)
 {
+  gint64 start;
+
+  start = g_get_monotonic_time ();
   g_signal_emit (G_OBJECT (window),
                  signals[ACTIONS_CHANGED],
                  0, changed_mask, new_actions);
+  _wnck_screen_record_window_change (window->priv->screen, window,
+                                     WNCK_WINDOW_CHANGED_ACTIONS,
+                                     g_get_monotonic_time () - start);
 }
 
 static void
 emit_geometry_changed (WnckWindow *window)
 {
+  gint64 start;
+
+  start = g_get_monotonic_time ();
   g_signal_emit (G_OBJECT (window),
                  signals[GEOMETRY_CHANGED],
                  0);
+  _wnck_screen_record_window_change (window->priv->screen, window,
+                                     WNCK_WINDOW_CHANGED_GEOMETRY,
+                                     g_get_monotonic_time () - start);
+
+  _wnck_screen_update_window_monitor (window->priv->screen, window);
+}
+
+static void
+emit_monitor_changed (WnckWindow *window)
+{
+  gint64 start;
+
+  start = g_get_monotonic_time ();
+  g_signal_emit (G_OBJECT (window),
+                 signals[MONITOR_CHANGED],
+                 0);
+  _wnck_screen_record_window_change (window->priv->screen, window,
+                                     WNCK_WINDOW_CHANGED_MONITOR,
+                                     g_get_monotonic_time () - start);
 }
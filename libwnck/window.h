@@ -275,9 +275,11 @@ struct _WnckWindowClass
 
   /* Changed size/position */
   void (* geometry_changed)      (WnckWindow       *window);
+
+  /* Moved to another monitor */
+  void (* monitor_changed)       (WnckWindow       *window);
   
   /* Padding for future expansion */
-  void (* pad1) (void);
   void (* pad2) (void);
   void (* pad3) (void);
   void (* pad4) (void);
@@ -407,6 +409,8 @@ void wnck_window_set_geometry (WnckWindow               *window,
                                int                       width,
                                int                       height);
 
+int  wnck_window_get_monitor  (WnckWindow *window);
+
 gboolean wnck_window_is_visible_on_workspace (WnckWindow    *window,
                                               WnckWorkspace *workspace);
 gboolean wnck_window_is_on_workspace         (WnckWindow    *window,
@@ -414,6 +418,19 @@ gboolean wnck_window_is_on_workspace         (WnckWindow    *window,
 gboolean wnck_window_is_in_viewport          (WnckWindow    *window,
                                               WnckWorkspace *workspace);
 
+/* these need the window enums, see screen.h for the rest of the API */
+void wnck_screen_operations_add_set_geometry    (WnckScreenOperations     *operations,
+                                                 WnckWindow               *window,
+                                                 WnckWindowGravity         gravity,
+                                                 WnckWindowMoveResizeMask  geometry_mask,
+                                                 int                       x,
+                                                 int                       y,
+                                                 int                       width,
+                                                 int                       height);
+void wnck_screen_operations_add_set_window_type (WnckScreenOperations     *operations,
+                                                 WnckWindow               *window,
+                                                 WnckWindowType            wintype);
+
 G_END_DECLS
 
 #endif /* WNCK_WINDOW_H */
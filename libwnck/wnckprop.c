@@ -34,6 +34,7 @@
  */
 #include <config.h>
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <X11/Xlib.h>
@@ -59,9 +60,21 @@ enum {
   CLASS_GROUP_READ_MODE,
   CLASS_GROUP_LIST_MODE,
   WINDOW_READ_MODE,
-  WINDOW_WRITE_MODE
+  WINDOW_WRITE_MODE,
+  WATCH_MODE,
+  BATCH_MODE
 } mode = INVALID_MODE;
 
+/* changes that can be reported by --watch */
+enum {
+  WATCH_NAME      = 1 << 0,
+  WATCH_STATE     = 1 << 1,
+  WATCH_WORKSPACE = 1 << 2,
+  WATCH_GEOMETRY  = 1 << 3,
+  WATCH_ACTIVE    = 1 << 4,
+  WATCH_ALL       = (1 << 5) - 1
+};
+
 gboolean option_xid = FALSE;
 gboolean option_application = FALSE;
 gboolean option_class_group = FALSE;
@@ -80,6 +93,13 @@ int      interact_screen = -1;
 gboolean list = FALSE;
 gboolean list_workspaces = FALSE;
 
+gboolean watch = FALSE;
+char     *watch_fields = NULL;
+int      watch_interval = -1;
+guint    watch_mask = WATCH_ALL;
+
+char     *batch_file = NULL;
+
 int      set_n_workspaces = -1;
 int      set_workspace_rows = 0;
 int      set_workspace_cols = 0;
@@ -166,6 +186,25 @@ static GOptionEntry list_entries[] = {
 	{ NULL }
 };
 
+static GOptionEntry watch_entries[] = {
+	{ "watch", 0, 0, G_OPTION_ARG_NONE, &watch,
+          N_("Report the windows of the screen and their changes until interrupted, as one JSON object per line"), NULL },
+	{ "watch-fields", 0, 0, G_OPTION_ARG_STRING, &watch_fields,
+          N_("Comma-separated list of changes to report: name, state, workspace, geometry, active (default: all)"),
+          N_("FIELDS") },
+	{ "watch-interval", 0, 0, G_OPTION_ARG_INT, &watch_interval,
+          N_("Report the changes of a window at most once every MSECS milliseconds"),
+          N_("MSECS") },
+	{ NULL }
+};
+
+static GOptionEntry batch_entries[] = {
+	{ "batch", 0, 0, G_OPTION_ARG_FILENAME, &batch_file,
+          N_("Read window operations from FILE (\"-\" for the standard input), one window per line in the format \"XID --option...\", using the options to modify properties of a window"),
+          N_("FILE") },
+	{ NULL }
+};
+
 static GOptionEntry screen_entries[] = {
 	{ "set-n-workspaces", 0, 0, G_OPTION_ARG_INT, &set_n_workspaces,
           N_("Change the number of workspaces of the screen to NUMBER"), N_("NUMBER") },
@@ -293,6 +332,7 @@ static GOptionEntry space_entries[] = {
 };
 
 static void clean_up (void);
+static gboolean validate_window_options (void);
 
 /* this part is mostly stolen from xutils.c */
 typedef struct
@@ -493,7 +533,8 @@ set_mode (int         new_mode,
         mode = new_mode;
         break;
       case SCREEN_READ_MODE:
-        if (new_mode == SCREEN_READ_MODE || new_mode == SCREEN_WRITE_MODE)
+        if (new_mode == SCREEN_READ_MODE || new_mode == SCREEN_WRITE_MODE ||
+            new_mode == WATCH_MODE || new_mode == BATCH_MODE)
           mode = new_mode;
         else if (list)
           mode = SCREEN_LIST_MODE;
@@ -626,6 +667,25 @@ set_mode (int         new_mode,
             return FALSE;
           }
         break;
+      case WATCH_MODE:
+        if (new_mode != WATCH_MODE)
+          {
+            g_printerr (_("Conflicting options are present: screen %d should "
+                          "be watched, but --%s has been used\n"),
+                        interact_screen, option);
+            return FALSE;
+          }
+        break;
+      case BATCH_MODE:
+        if (new_mode != BATCH_MODE)
+          {
+            g_printerr (_("Conflicting options are present: window operations "
+                          "should be read from a file, but --%s has been "
+                          "used\n"),
+                        option);
+            return FALSE;
+          }
+        break;
       default:
         g_assert_not_reached ();
     }
@@ -716,6 +776,47 @@ validate_options (void)
     if (!set_mode (SCREEN_READ_MODE, "screen", FALSE))
       return FALSE;
 
+  CHECK_BOOL_REAL (watch, "watch", WATCH_MODE)
+  if (watch_fields != NULL)
+    {
+      char **fields;
+      int    i;
+
+      if (!set_mode (WATCH_MODE, "watch-fields", FALSE))
+        return FALSE;
+
+      watch_mask = 0;
+      fields = g_strsplit (watch_fields, ",", -1);
+      for (i = 0; fields[i] != NULL; i++)
+        {
+          g_strstrip (fields[i]);
+
+          if (strcmp (fields[i], "name") == 0)
+            watch_mask |= WATCH_NAME;
+          else if (strcmp (fields[i], "state") == 0)
+            watch_mask |= WATCH_STATE;
+          else if (strcmp (fields[i], "workspace") == 0)
+            watch_mask |= WATCH_WORKSPACE;
+          else if (strcmp (fields[i], "geometry") == 0)
+            watch_mask |= WATCH_GEOMETRY;
+          else if (strcmp (fields[i], "active") == 0)
+            watch_mask |= WATCH_ACTIVE;
+          else if (fields[i][0] != '\0')
+            {
+              g_printerr (_("Invalid argument \"%s\" for --%s, valid values "
+                            "are: %s\n"),
+                          fields[i], "watch-fields",
+                          "name, state, workspace, geometry, active");
+              g_strfreev (fields);
+              return FALSE;
+            }
+        }
+      g_strfreev (fields);
+    }
+  CHECK_POSITIVE_INT (watch_interval, "watch-interval", WATCH_MODE)
+
+  CHECK_BOOL_REAL (batch_file != NULL, "batch", BATCH_MODE)
+
   CHECK_BOOL_REAL (list_workspaces, "list-workspaces", SCREEN_LIST_MODE)
 
   if (list && list_workspaces)
@@ -746,7 +847,8 @@ validate_options (void)
 
   /* screen options can work by assuming it's on the default screen */
   if (mode == SCREEN_READ_MODE || mode == SCREEN_LIST_MODE ||
-      mode == SCREEN_WRITE_MODE)
+      mode == SCREEN_WRITE_MODE || mode == WATCH_MODE ||
+      mode == BATCH_MODE)
     {
       get_from_user = FALSE;
       option_screen = TRUE;
@@ -761,6 +863,27 @@ validate_options (void)
     if (!set_mode (WORKSPACE_WRITE_MODE, "change-name", FALSE))
       return FALSE;
 
+  if (!validate_window_options ())
+    return FALSE;
+
+  if (set_activate)
+    {
+      if (mode == WORKSPACE_READ_MODE || mode == WORKSPACE_WRITE_MODE)
+        set_mode (WORKSPACE_WRITE_MODE, "activate", FALSE);
+      else if (mode == WINDOW_READ_MODE || mode == WINDOW_WRITE_MODE)
+        set_mode (WINDOW_WRITE_MODE, "activate", FALSE);
+      else
+        return set_mode (INVALID_MODE, "activate", FALSE);
+    }
+
+  return TRUE;
+}
+
+/* This is also used for each line of --batch, so it must only look at the
+ * options of window_entries. */
+static gboolean
+validate_window_options (void)
+{
   CHECK_DUAL_OPTIONS (minimize, WINDOW_WRITE_MODE)
   CHECK_DUAL_OPTIONS (maximize, WINDOW_WRITE_MODE)
   CHECK_DUAL_OPTIONS (maximize_horizontally, WINDOW_WRITE_MODE)
@@ -829,16 +952,6 @@ validate_options (void)
         return FALSE;
     }
 
-  if (set_activate)
-    {
-      if (mode == WORKSPACE_READ_MODE || mode == WORKSPACE_WRITE_MODE)
-        set_mode (WORKSPACE_WRITE_MODE, "activate", FALSE);
-      else if (mode == WINDOW_READ_MODE || mode == WINDOW_WRITE_MODE)
-        set_mode (WINDOW_WRITE_MODE, "activate", FALSE);
-      else
-        return set_mode (INVALID_MODE, "activate", FALSE);
-    }
-
   return TRUE;
 }
 
@@ -923,63 +1036,86 @@ update_workspace (WnckWorkspace *space)
 }
 
 
+/* With operations, the requests are queued there instead of being sent
+ * right away, so that --batch sends them all at once, in order. */
 static void
-update_window (WnckWindow *window)
+update_window (WnckWindow           *window,
+               guint32               timestamp,
+               WnckScreenOperations *operations)
 {
   WnckWindowActions        actions;
   WnckWindowMoveResizeMask geometry_mask;
-  unsigned int             timestamp;
 
   actions = wnck_window_get_actions (window);
-  timestamp = get_xserver_timestamp (wnck_window_get_screen (window));
 
-#define SET_PROPERTY(name, action)                                      \
+#define QUEUE_OR_CALL(operation, call)                                  \
+  if (operations)                                                       \
+    wnck_screen_operations_add (operations, window, operation);         \
+  else                                                                  \
+    call;
+
+#define SET_PROPERTY(name, action, operation)                           \
   if (set_##name)                                                       \
     {                                                                   \
       if (actions & action)                                             \
-        wnck_window_##name (window);                                    \
+        {                                                               \
+          QUEUE_OR_CALL (operation, wnck_window_##name (window))        \
+        }                                                               \
       else                                                              \
         g_printerr (_("Action not allowed\n"));                         \
     }
 
-#define SET_PROPERTY_TIMESTAMP(name, action)                            \
+#define SET_PROPERTY_TIMESTAMP(name, action, operation)                 \
   if (set_##name)                                                       \
     {                                                                   \
       if (actions & action)                                             \
-        wnck_window_##name (window, timestamp);                         \
+        {                                                               \
+          QUEUE_OR_CALL (operation,                                     \
+                         wnck_window_##name (window, timestamp))        \
+        }                                                               \
       else                                                              \
         g_printerr (_("Action not allowed\n"));                         \
     }
 
-#define SET_PROPERTY_DUAL(name, action1, action2)                       \
+#define SET_PROPERTY_DUAL(name, action1, action2, operation1, operation2) \
   if (set_##name)                                                       \
     {                                                                   \
       if (actions & action1)                                            \
-        wnck_window_##name (window);                                    \
+        {                                                               \
+          QUEUE_OR_CALL (operation1, wnck_window_##name (window))       \
+        }                                                               \
       else                                                              \
         g_printerr (_("Action not allowed\n"));                         \
     }                                                                   \
   else if (set_un##name)                                                \
     {                                                                   \
       if (actions & action2)                                            \
-        wnck_window_un##name (window);                                  \
+        {                                                               \
+          QUEUE_OR_CALL (operation2, wnck_window_un##name (window))     \
+        }                                                               \
       else                                                              \
         g_printerr (_("Action not allowed\n"));                         \
     }
 
 /* FIXME: why do we have dual & boolean API. This is not consistent! */
-#define SET_PROPERTY_BOOLEAN(name, action1, action2)                    \
+#define SET_PROPERTY_BOOLEAN(name, action1, action2, operation1, operation2) \
   if (set_##name)                                                       \
     {                                                                   \
       if (actions & action1)                                            \
-        wnck_window_set_##name (window, TRUE);                          \
+        {                                                               \
+          QUEUE_OR_CALL (operation1,                                    \
+                         wnck_window_set_##name (window, TRUE))         \
+        }                                                               \
       else                                                              \
         g_printerr (_("Action not allowed\n"));                         \
     }                                                                   \
   else if (set_un##name)                                                \
     {                                                                   \
       if (actions & action2)                                            \
-        wnck_window_set_##name (window, FALSE);                         \
+        {                                                               \
+          QUEUE_OR_CALL (operation2,                                    \
+                         wnck_window_set_##name (window, FALSE))        \
+        }                                                               \
       else                                                              \
         g_printerr (_("Action not allowed\n"));                         \
     }
@@ -993,35 +1129,59 @@ update_window (WnckWindow *window)
         g_printerr (_("Action not allowed\n"));                         \
     }
 
-  SET_PROPERTY (minimize, WNCK_WINDOW_ACTION_MINIMIZE)
-  SET_PROPERTY_TIMESTAMP (unminimize, WNCK_WINDOW_ACTION_UNMINIMIZE)
+  SET_PROPERTY (minimize, WNCK_WINDOW_ACTION_MINIMIZE,
+                WNCK_WINDOW_OPERATION_MINIMIZE)
+  SET_PROPERTY_TIMESTAMP (unminimize, WNCK_WINDOW_ACTION_UNMINIMIZE,
+                          WNCK_WINDOW_OPERATION_UNMINIMIZE)
 
   SET_PROPERTY_DUAL (maximize,
                      WNCK_WINDOW_ACTION_MAXIMIZE,
-                     WNCK_WINDOW_ACTION_UNMAXIMIZE)
+                     WNCK_WINDOW_ACTION_UNMAXIMIZE,
+                     WNCK_WINDOW_OPERATION_MAXIMIZE,
+                     WNCK_WINDOW_OPERATION_UNMAXIMIZE)
   SET_PROPERTY_DUAL (maximize_horizontally,
                      WNCK_WINDOW_ACTION_MAXIMIZE_HORIZONTALLY,
-                     WNCK_WINDOW_ACTION_UNMAXIMIZE_HORIZONTALLY)
+                     WNCK_WINDOW_ACTION_UNMAXIMIZE_HORIZONTALLY,
+                     WNCK_WINDOW_OPERATION_MAXIMIZE_HORIZONTALLY,
+                     WNCK_WINDOW_OPERATION_UNMAXIMIZE_HORIZONTALLY)
   SET_PROPERTY_DUAL (maximize_vertically,
                      WNCK_WINDOW_ACTION_MAXIMIZE_VERTICALLY,
-                     WNCK_WINDOW_ACTION_UNMAXIMIZE_VERTICALLY)
+                     WNCK_WINDOW_ACTION_UNMAXIMIZE_VERTICALLY,
+                     WNCK_WINDOW_OPERATION_MAXIMIZE_VERTICALLY,
+                     WNCK_WINDOW_OPERATION_UNMAXIMIZE_VERTICALLY)
 
   SET_PROPERTY_BOOLEAN (fullscreen,
                         WNCK_WINDOW_ACTION_FULLSCREEN,
-                        WNCK_WINDOW_ACTION_FULLSCREEN)
+                        WNCK_WINDOW_ACTION_FULLSCREEN,
+                        WNCK_WINDOW_OPERATION_FULLSCREEN,
+                        WNCK_WINDOW_OPERATION_UNFULLSCREEN)
   SET_PROPERTY_DUAL (make_above,
-                     WNCK_WINDOW_ACTION_ABOVE, WNCK_WINDOW_ACTION_ABOVE)
+                     WNCK_WINDOW_ACTION_ABOVE, WNCK_WINDOW_ACTION_ABOVE,
+                     WNCK_WINDOW_OPERATION_MAKE_ABOVE,
+                     WNCK_WINDOW_OPERATION_UNMAKE_ABOVE)
   SET_PROPERTY_DUAL (make_below,
-                     WNCK_WINDOW_ACTION_BELOW, WNCK_WINDOW_ACTION_BELOW)
+                     WNCK_WINDOW_ACTION_BELOW, WNCK_WINDOW_ACTION_BELOW,
+                     WNCK_WINDOW_OPERATION_MAKE_BELOW,
+                     WNCK_WINDOW_OPERATION_UNMAKE_BELOW)
   SET_PROPERTY_DUAL (shade,
-                     WNCK_WINDOW_ACTION_SHADE, WNCK_WINDOW_ACTION_UNSHADE)
+                     WNCK_WINDOW_ACTION_SHADE, WNCK_WINDOW_ACTION_UNSHADE,
+                     WNCK_WINDOW_OPERATION_SHADE,
+                     WNCK_WINDOW_OPERATION_UNSHADE)
   SET_PROPERTY_DUAL (stick,
-                     WNCK_WINDOW_ACTION_STICK, WNCK_WINDOW_ACTION_UNSTICK)
-  SET_PROPERTY_BOOLEAN (skip_pager, actions, actions)
-  SET_PROPERTY_BOOLEAN (skip_tasklist, actions, actions)
+                     WNCK_WINDOW_ACTION_STICK, WNCK_WINDOW_ACTION_UNSTICK,
+                     WNCK_WINDOW_OPERATION_STICK,
+                     WNCK_WINDOW_OPERATION_UNSTICK)
+  SET_PROPERTY_BOOLEAN (skip_pager, actions, actions,
+                        WNCK_WINDOW_OPERATION_SKIP_PAGER,
+                        WNCK_WINDOW_OPERATION_UNSKIP_PAGER)
+  SET_PROPERTY_BOOLEAN (skip_tasklist, actions, actions,
+                        WNCK_WINDOW_OPERATION_SKIP_TASKLIST,
+                        WNCK_WINDOW_OPERATION_UNSKIP_TASKLIST)
   SET_PROPERTY_DUAL (pin,
                      WNCK_WINDOW_ACTION_CHANGE_WORKSPACE,
-                     WNCK_WINDOW_ACTION_CHANGE_WORKSPACE)
+                     WNCK_WINDOW_ACTION_CHANGE_WORKSPACE,
+                     WNCK_WINDOW_OPERATION_PIN,
+                     WNCK_WINDOW_OPERATION_UNPIN)
 
   if (set_workspace != -1)
     {
@@ -1032,7 +1192,10 @@ update_window (WnckWindow *window)
 
            screen = wnck_window_get_screen (window);
            space = wnck_screen_get_workspace (screen, set_workspace);
-           if (space)
+           if (space && operations)
+             wnck_screen_operations_add_move_to_workspace (operations,
+                                                           window, space);
+           else if (space)
              wnck_window_move_to_workspace (window, space);
            else
              g_printerr (_("Window cannot be moved to workspace %d: "
@@ -1043,7 +1206,14 @@ update_window (WnckWindow *window)
     }
 
   /* do activation after the workspace change */
-  if (set_activate)
+  if (set_activate && operations)
+    {
+      /* the window manager shows the workspace of the window it
+       * activates */
+      wnck_screen_operations_add (operations, window,
+                                  WNCK_WINDOW_OPERATION_ACTIVATE);
+    }
+  else if (set_activate)
     {
        WnckScreen    *screen;
        WnckWorkspace *space;
@@ -1068,20 +1238,41 @@ update_window (WnckWindow *window)
   SET_GEOMETRY (width, -1, WNCK_WINDOW_ACTION_RESIZE, WNCK_WINDOW_CHANGE_WIDTH)
   SET_GEOMETRY (height, -1, WNCK_WINDOW_ACTION_RESIZE, WNCK_WINDOW_CHANGE_HEIGHT)
 
-  if (geometry_mask != 0)
+  if (geometry_mask != 0 && operations)
+    wnck_screen_operations_add_set_geometry (operations, window,
+                                             WNCK_WINDOW_GRAVITY_CURRENT,
+                                             geometry_mask,
+                                             set_x, set_y,
+                                             set_width, set_height);
+  else if (geometry_mask != 0)
     wnck_window_set_geometry (window,
                               WNCK_WINDOW_GRAVITY_CURRENT, geometry_mask,
                               set_x, set_y, set_width, set_height);
 
-  if (set_window_type != NULL)
+  if (set_window_type != NULL && operations)
+    wnck_screen_operations_add_set_window_type (operations, window,
+                                                set_window_type_t);
+  else if (set_window_type != NULL)
     wnck_window_set_window_type (window, set_window_type_t);
 
-  /* interactive actions at the end */
-  SET_PROPERTY (keyboard_move, WNCK_WINDOW_ACTION_MOVE)
-  /* FIXME: hack: we should rename the API */
-  #define wnck_window_keyboard_resize wnck_window_keyboard_size
-  SET_PROPERTY (keyboard_resize, WNCK_WINDOW_ACTION_RESIZE)
-  SET_PROPERTY_TIMESTAMP (close, WNCK_WINDOW_ACTION_CLOSE)
+  /* interactive actions at the end; --batch does not accept them */
+  if (set_keyboard_move)
+    {
+      if (actions & WNCK_WINDOW_ACTION_MOVE)
+        wnck_window_keyboard_move (window);
+      else
+        g_printerr (_("Action not allowed\n"));
+    }
+  if (set_keyboard_resize)
+    {
+      /* FIXME: we should rename the API */
+      if (actions & WNCK_WINDOW_ACTION_RESIZE)
+        wnck_window_keyboard_size (window);
+      else
+        g_printerr (_("Action not allowed\n"));
+    }
+  SET_PROPERTY_TIMESTAMP (close, WNCK_WINDOW_ACTION_CLOSE,
+                          WNCK_WINDOW_OPERATION_CLOSE)
 }
 
 static void
@@ -1823,6 +2014,554 @@ clean_up (void)
   gtk_main_quit ();
 }
 
+/* --watch: every line printed is a JSON object with an "event" member,
+ * "window_opened", "window_closed", "window_changed" or
+ * "active_window_changed", and a "time" member in milliseconds since the
+ * Epoch.
+ */
+static GHashTable *watch_pending = NULL;
+static gboolean    watch_active_pending = FALSE;
+static guint       watch_flush_id = 0;
+
+static const struct {
+  WnckWindowState  state;
+  const char      *name;
+} watch_states[] = {
+  { WNCK_WINDOW_STATE_MINIMIZED,              "minimized" },
+  { WNCK_WINDOW_STATE_MAXIMIZED_HORIZONTALLY, "maximized_horizontally" },
+  { WNCK_WINDOW_STATE_MAXIMIZED_VERTICALLY,   "maximized_vertically" },
+  { WNCK_WINDOW_STATE_SHADED,                 "shaded" },
+  { WNCK_WINDOW_STATE_SKIP_PAGER,             "skip_pager" },
+  { WNCK_WINDOW_STATE_SKIP_TASKLIST,          "skip_tasklist" },
+  { WNCK_WINDOW_STATE_STICKY,                 "sticky" },
+  { WNCK_WINDOW_STATE_HIDDEN,                 "hidden" },
+  { WNCK_WINDOW_STATE_FULLSCREEN,             "fullscreen" },
+  { WNCK_WINDOW_STATE_DEMANDS_ATTENTION,      "demands_attention" },
+  { WNCK_WINDOW_STATE_URGENT,                 "urgent" },
+  { WNCK_WINDOW_STATE_ABOVE,                  "above" },
+  { WNCK_WINDOW_STATE_BELOW,                  "below" }
+};
+
+static void
+watch_append_string (GString    *str,
+                     const char *value)
+{
+  const char *p;
+
+  g_string_append_c (str, '"');
+
+  for (p = value; *p != '\0'; p++)
+    {
+      switch (*p)
+        {
+          case '"':
+            g_string_append (str, "\\\"");
+            break;
+          case '\\':
+            g_string_append (str, "\\\\");
+            break;
+          case '\n':
+            g_string_append (str, "\\n");
+            break;
+          case '\t':
+            g_string_append (str, "\\t");
+            break;
+          default:
+            if ((guchar) *p < 0x20)
+              g_string_append_printf (str, "\\u%04x", (guchar) *p);
+            else
+              g_string_append_c (str, *p);
+            break;
+        }
+    }
+
+  g_string_append_c (str, '"');
+}
+
+static GString *
+watch_begin (const char *event)
+{
+  GString *str;
+  GTimeVal tv;
+
+  g_get_current_time (&tv);
+
+  str = g_string_new (NULL);
+  g_string_append_printf (str, "{\"event\":\"%s\",\"time\":%" G_GINT64_FORMAT,
+                          event,
+                          (gint64) tv.tv_sec * 1000 + tv.tv_usec / 1000);
+
+  return str;
+}
+
+static void
+watch_end (GString *str)
+{
+  g_string_append (str, "}\n");
+
+  fputs (str->str, stdout);
+  fflush (stdout);
+
+  g_string_free (str, TRUE);
+}
+
+static void
+watch_append_window (GString    *str,
+                     WnckWindow *window,
+                     guint       fields)
+{
+  g_string_append_printf (str, ",\"xid\":%lu", wnck_window_get_xid (window));
+
+  if (fields & WATCH_NAME)
+    {
+      g_string_append (str, ",\"name\":");
+      watch_append_string (str, wnck_window_get_name (window));
+    }
+
+  if (fields & WATCH_STATE)
+    {
+      WnckWindowState state;
+      gboolean        first;
+      guint           i;
+
+      state = wnck_window_get_state (window);
+      first = TRUE;
+
+      g_string_append (str, ",\"state\":[");
+      for (i = 0; i < G_N_ELEMENTS (watch_states); i++)
+        if (state & watch_states[i].state)
+          {
+            g_string_append_printf (str, "%s\"%s\"",
+                                    first ? "" : ",", watch_states[i].name);
+            first = FALSE;
+          }
+      g_string_append_c (str, ']');
+    }
+
+  if (fields & WATCH_WORKSPACE)
+    {
+      WnckWorkspace *space;
+
+      space = wnck_window_get_workspace (window);
+      if (space)
+        g_string_append_printf (str, ",\"workspace\":%d",
+                                wnck_workspace_get_number (space));
+      else
+        /* pinned, or no workspace at all */
+        g_string_append (str, ",\"workspace\":null");
+    }
+
+  if (fields & WATCH_GEOMETRY)
+    {
+      int x, y, width, height;
+
+      wnck_window_get_geometry (window, &x, &y, &width, &height);
+      g_string_append_printf (str,
+                              ",\"geometry\":{\"x\":%d,\"y\":%d,"
+                              "\"width\":%d,\"height\":%d}",
+                              x, y, width, height);
+    }
+}
+
+static void
+watch_print_changes (WnckWindow *window,
+                     guint       changes)
+{
+  GString *str;
+
+  str = watch_begin ("window_changed");
+  watch_append_window (str, window, changes);
+  watch_end (str);
+}
+
+static void
+watch_print_active (WnckScreen *screen)
+{
+  WnckWindow *active;
+  GString    *str;
+
+  active = wnck_screen_get_active_window (screen);
+
+  str = watch_begin ("active_window_changed");
+  if (active)
+    g_string_append_printf (str, ",\"xid\":%lu", wnck_window_get_xid (active));
+  else
+    g_string_append (str, ",\"xid\":null");
+  watch_end (str);
+}
+
+static gboolean
+watch_flush (gpointer data)
+{
+  WnckScreen     *screen = data;
+  GHashTableIter  iter;
+  gpointer        window, changes;
+
+  watch_flush_id = 0;
+
+  g_hash_table_iter_init (&iter, watch_pending);
+  while (g_hash_table_iter_next (&iter, &window, &changes))
+    watch_print_changes (WNCK_WINDOW (window), GPOINTER_TO_UINT (changes));
+  g_hash_table_remove_all (watch_pending);
+
+  if (watch_active_pending)
+    watch_print_active (screen);
+  watch_active_pending = FALSE;
+
+  return FALSE;
+}
+
+static void
+watch_queue_flush (WnckScreen *screen)
+{
+  if (watch_flush_id == 0)
+    watch_flush_id = g_timeout_add (watch_interval, watch_flush, screen);
+}
+
+/* With --watch-interval, changes are coalesced per window, and only the
+ * latest state is reported when the interval is over.
+ */
+static void
+watch_window_changed (WnckWindow *window,
+                      guint       change)
+{
+  guint changes;
+
+  if (!(watch_mask & change))
+    return;
+
+  if (watch_interval <= 0)
+    {
+      watch_print_changes (window, change);
+      return;
+    }
+
+  changes = GPOINTER_TO_UINT (g_hash_table_lookup (watch_pending, window));
+  g_hash_table_insert (watch_pending, window, GUINT_TO_POINTER (changes | change));
+
+  watch_queue_flush (wnck_window_get_screen (window));
+}
+
+static void
+watch_name_changed (WnckWindow *window,
+                    gpointer    data)
+{
+  watch_window_changed (window, WATCH_NAME);
+}
+
+static void
+watch_state_changed (WnckWindow      *window,
+                     WnckWindowState  changed_mask,
+                     WnckWindowState  new_state,
+                     gpointer         data)
+{
+  watch_window_changed (window, WATCH_STATE);
+}
+
+static void
+watch_workspace_changed (WnckWindow *window,
+                         gpointer    data)
+{
+  watch_window_changed (window, WATCH_WORKSPACE);
+}
+
+static void
+watch_geometry_changed (WnckWindow *window,
+                        gpointer    data)
+{
+  watch_window_changed (window, WATCH_GEOMETRY);
+}
+
+static void
+watch_window_opened (WnckScreen *screen,
+                     WnckWindow *window,
+                     gpointer    data)
+{
+  GString *str;
+
+  str = watch_begin ("window_opened");
+  watch_append_window (str, window, watch_mask);
+  watch_end (str);
+
+  g_signal_connect (G_OBJECT (window), "name_changed",
+                    G_CALLBACK (watch_name_changed), NULL);
+  g_signal_connect (G_OBJECT (window), "state_changed",
+                    G_CALLBACK (watch_state_changed), NULL);
+  g_signal_connect (G_OBJECT (window), "workspace_changed",
+                    G_CALLBACK (watch_workspace_changed), NULL);
+  g_signal_connect (G_OBJECT (window), "geometry_changed",
+                    G_CALLBACK (watch_geometry_changed), NULL);
+}
+
+static void
+watch_window_closed (WnckScreen *screen,
+                     WnckWindow *window,
+                     gpointer    data)
+{
+  GString *str;
+  gpointer changes;
+
+  /* the window is still valid: report what it was up to */
+  changes = g_hash_table_lookup (watch_pending, window);
+  if (changes != NULL)
+    {
+      watch_print_changes (window, GPOINTER_TO_UINT (changes));
+      g_hash_table_remove (watch_pending, window);
+    }
+
+  str = watch_begin ("window_closed");
+  watch_append_window (str, window, watch_mask & WATCH_NAME);
+  watch_end (str);
+}
+
+static void
+watch_active_window_changed (WnckScreen *screen,
+                             WnckWindow *previous_window,
+                             gpointer    data)
+{
+  if (!(watch_mask & WATCH_ACTIVE))
+    return;
+
+  if (watch_interval <= 0)
+    watch_print_active (screen);
+  else
+    {
+      watch_active_pending = TRUE;
+      watch_queue_flush (screen);
+    }
+}
+
+static void
+watch_screen (WnckScreen *screen)
+{
+  watch_pending = g_hash_table_new (NULL, NULL);
+
+  g_signal_connect (G_OBJECT (screen), "window_opened",
+                    G_CALLBACK (watch_window_opened), NULL);
+  g_signal_connect (G_OBJECT (screen), "window_closed",
+                    G_CALLBACK (watch_window_closed), NULL);
+  g_signal_connect (G_OBJECT (screen), "active_window_changed",
+                    G_CALLBACK (watch_active_window_changed), NULL);
+}
+
+/* --batch: every line is "XID --option...", with the options of
+ * window_entries. Empty lines and lines starting with '#' are ignored. All
+ * the lines are applied against the same screen, with the same timestamp:
+ * their operations are collected in one WnckScreenOperations, and sent at
+ * once and in order after the last line. Interactive operations are not
+ * accepted.
+ */
+static void
+batch_reset_window_options (void)
+{
+  set_activate = FALSE;
+
+  set_minimize = FALSE;
+  set_unminimize = FALSE;
+  set_maximize = FALSE;
+  set_unmaximize = FALSE;
+  set_maximize_horizontally = FALSE;
+  set_unmaximize_horizontally = FALSE;
+  set_maximize_vertically = FALSE;
+  set_unmaximize_vertically = FALSE;
+  set_keyboard_move = FALSE;
+  set_keyboard_resize = FALSE;
+  set_close = FALSE;
+
+  set_fullscreen = FALSE;
+  set_unfullscreen = FALSE;
+  set_make_above = FALSE;
+  set_unmake_above = FALSE;
+  set_make_below = FALSE;
+  set_unmake_below = FALSE;
+  set_shade = FALSE;
+  set_unshade = FALSE;
+  set_stick = FALSE;
+  set_unstick = FALSE;
+  set_skip_pager = FALSE;
+  set_unskip_pager = FALSE;
+  set_skip_tasklist = FALSE;
+  set_unskip_tasklist = FALSE;
+  set_pin = FALSE;
+  set_unpin = FALSE;
+  set_workspace = -1;
+  set_x = G_MAXINT;
+  set_y = G_MAXINT;
+  set_width = -1;
+  set_height = -1;
+  g_free (set_window_type);
+  set_window_type = NULL;
+  set_window_type_t = WNCK_WINDOW_NORMAL;
+}
+
+static gboolean
+batch_run_line (const char           *line,
+                int                   lineno,
+                guint32               timestamp,
+                WnckScreenOperations *operations)
+{
+  GOptionContext  *ctxt;
+  GError          *error;
+  char           **line_argv;
+  char           **parse_argv;
+  int              line_argc;
+  int              parse_argc;
+  gulong           line_xid;
+  char            *end;
+  WnckWindow      *window;
+  gboolean         retval;
+
+  error = NULL;
+  if (!g_shell_parse_argv (line, &line_argc, &line_argv, &error))
+    {
+      g_printerr (_("Line %d: %s\n"), lineno, error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  /* XIDs are accepted in hexadecimal too, since this is how most tools
+   * print them */
+  line_xid = strtoul (line_argv[0], &end, 0);
+  if (end == line_argv[0] || end[0] != '\0')
+    {
+      g_printerr (_("Line %d: invalid window ID \"%s\"\n"),
+                  lineno, line_argv[0]);
+      g_strfreev (line_argv);
+      return FALSE;
+    }
+
+  /* the window ID takes the place of the program name; the parser shuffles
+   * the array it gets, so give it a copy and free the original strings */
+  parse_argc = line_argc;
+  parse_argv = g_new (char *, line_argc + 1);
+  memcpy (parse_argv, line_argv, (line_argc + 1) * sizeof (char *));
+
+  batch_reset_window_options ();
+
+  ctxt = g_option_context_new (NULL);
+  g_option_context_set_help_enabled (ctxt, FALSE);
+  g_option_context_add_main_entries (ctxt, window_entries, GETTEXT_PACKAGE);
+
+  retval = g_option_context_parse (ctxt, &parse_argc, &parse_argv, &error);
+  g_option_context_free (ctxt);
+
+  if (!retval)
+    {
+      g_printerr (_("Line %d: %s\n"), lineno, error->message);
+      g_error_free (error);
+    }
+  else if (parse_argc > 1)
+    {
+      g_printerr (_("Line %d: unexpected argument \"%s\"\n"),
+                  lineno, parse_argv[1]);
+      retval = FALSE;
+    }
+
+  g_free (parse_argv);
+  g_strfreev (line_argv);
+
+  if (!retval)
+    return FALSE;
+
+  mode = WINDOW_READ_MODE;
+  retval = validate_window_options ();
+  if (retval && (set_keyboard_move || set_keyboard_resize))
+    {
+      g_printerr (_("Line %d: --%s and --%s cannot be used in a batch\n"),
+                  lineno, "keyboard-move", "keyboard-resize");
+      retval = FALSE;
+    }
+  if (retval && set_activate)
+    retval = set_mode (WINDOW_WRITE_MODE, "activate", FALSE);
+  if (retval && mode != WINDOW_WRITE_MODE)
+    {
+      g_printerr (_("Line %d: no operation for window with XID %lu\n"),
+                  lineno, line_xid);
+      retval = FALSE;
+    }
+  mode = BATCH_MODE;
+
+  if (!retval)
+    return FALSE;
+
+  window = wnck_window_get (line_xid);
+  if (window == NULL)
+    {
+      g_printerr (_("Line %d: cannot interact with window with XID %lu: "
+                    "the window cannot be found\n"), lineno, line_xid);
+      return FALSE;
+    }
+
+  update_window (window, timestamp, operations);
+
+  return TRUE;
+}
+
+static gboolean
+batch_run (WnckScreen *screen)
+{
+  GIOChannel           *channel;
+  GError               *error;
+  GIOStatus             status;
+  char                 *line;
+  int                   lineno;
+  guint32               timestamp;
+  WnckScreenOperations *operations;
+  gboolean              retval;
+
+  error = NULL;
+  if (strcmp (batch_file, "-") == 0)
+    channel = g_io_channel_unix_new (fileno (stdin));
+  else
+    channel = g_io_channel_new_file (batch_file, "r", &error);
+
+  if (channel == NULL)
+    {
+      g_printerr (_("Cannot read window operations from \"%s\": %s\n"),
+                  batch_file, error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  /* every line is resolved against this one update of the screen, and
+   * all the operations use the same timestamp */
+  wnck_screen_force_update (screen);
+  timestamp = get_xserver_timestamp (screen);
+  operations = wnck_screen_operations_new (screen);
+
+  retval = TRUE;
+  lineno = 0;
+
+  while ((status = g_io_channel_read_line (channel, &line,
+                                           NULL, NULL, &error)) == G_IO_STATUS_NORMAL)
+    {
+      lineno++;
+
+      g_strstrip (line);
+      if (line[0] != '\0' && line[0] != '#')
+        if (!batch_run_line (line, lineno, timestamp, operations))
+          retval = FALSE;
+
+      g_free (line);
+    }
+
+  if (status == G_IO_STATUS_ERROR)
+    {
+      g_printerr (_("Cannot read window operations from \"%s\": %s\n"),
+                  batch_file, error->message);
+      g_error_free (error);
+      retval = FALSE;
+    }
+
+  g_io_channel_unref (channel);
+
+  /* send the operations of all the lines, with only one flush */
+  wnck_screen_operations_commit (operations, timestamp);
+  wnck_screen_operations_free (operations);
+
+  return retval;
+}
+
 int
 main (int argc, char **argv)
 {
@@ -1856,6 +2595,22 @@ main (int argc, char **argv)
   g_option_group_set_translation_domain (group, GETTEXT_PACKAGE);
   g_option_context_add_group (ctxt, group);
 
+  group = g_option_group_new ("watch",
+                              N_("Options to watch the windows of a screen"),
+                              N_("Show options to watch the windows of a screen"),
+                              NULL, NULL);
+  g_option_group_add_entries (group, watch_entries);
+  g_option_group_set_translation_domain (group, GETTEXT_PACKAGE);
+  g_option_context_add_group (ctxt, group);
+
+  group = g_option_group_new ("batch",
+                              N_("Options to modify many windows at once"),
+                              N_("Show options to modify many windows at once"),
+                              NULL, NULL);
+  g_option_group_add_entries (group, batch_entries);
+  g_option_group_set_translation_domain (group, GETTEXT_PACKAGE);
+  g_option_context_add_group (ctxt, group);
+
   group = g_option_group_new ("window",
                               N_("Options to modify properties of a window"),
                               N_("Show options to modify properties of a window"),
@@ -1914,8 +2669,29 @@ main (int argc, char **argv)
         }
     }
 
-  /* because we don't respond to signals at the moment */
-  wnck_screen_force_update (screen);
+  if (mode == WATCH_MODE)
+    {
+      /* the windows already open are reported by the first update */
+      watch_screen (screen);
+      gtk_main ();
+
+      return 0;
+    }
+
+  if (mode == BATCH_MODE)
+    return batch_run (screen) ? 0 : 1;
+
+  /* because we don't respond to signals at the moment; when only one
+   * window or workspaces are needed, don't read all the other windows */
+  if (get_from_user)
+    wnck_screen_force_update (screen);
+  else if (mode == WINDOW_READ_MODE || mode == WINDOW_WRITE_MODE)
+    wnck_screen_force_update_window (screen, xid);
+  else if (mode == SCREEN_WRITE_MODE ||
+           mode == WORKSPACE_READ_MODE || mode == WORKSPACE_WRITE_MODE)
+    wnck_screen_force_update_workspaces (screen);
+  else
+    wnck_screen_force_update (screen);
 
   if (option_workspace && interact_space < 0)
     {
@@ -2027,7 +2803,9 @@ main (int argc, char **argv)
       if (window)
         {
           if (mode == WINDOW_WRITE_MODE)
-            update_window (window);
+            update_window (window,
+                           get_xserver_timestamp (wnck_window_get_screen (window)),
+                           NULL);
           else if (mode == WINDOW_READ_MODE)
             print_window (window);
           else
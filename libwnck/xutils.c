@@ -26,6 +26,12 @@
 #include <string.h>
 #include <stdio.h>
 #include <cairo-xlib.h>
+#ifdef HAVE_XSHM
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+#endif
 #include "screen.h"
 #include "window.h"
 #include "private.h"
@@ -709,6 +715,40 @@ _wnck_error_trap_pop (Display *display)
   return gdk_error_trap_pop ();
 }
 
+/* Number of nested _wnck_begin_request_batch() */
+static int request_batch_depth = 0;
+
+/* Used instead of _wnck_error_trap_pop() by the helpers that only send a
+ * request and don't look at the result: in a request batch, errors are
+ * ignored without a round-trip to the server, and the requests are flushed
+ * by _wnck_end_request_batch().
+ */
+void
+_wnck_error_trap_pop_request (Display *display)
+{
+  if (request_batch_depth > 0)
+    gdk_error_trap_pop_ignored ();
+  else
+    _wnck_error_trap_pop (display);
+}
+
+void
+_wnck_begin_request_batch (void)
+{
+  request_batch_depth++;
+}
+
+void
+_wnck_end_request_batch (Display *display)
+{
+  g_return_if_fail (request_batch_depth > 0);
+
+  request_batch_depth--;
+
+  if (request_batch_depth == 0)
+    XFlush (display);
+}
+
 static GdkFilterReturn
 filter_func (GdkXEvent  *gdkxevent,
              GdkEvent   *event,
@@ -754,6 +794,42 @@ filter_func (GdkXEvent  *gdkxevent,
 
         if (window)
           _wnck_window_process_configure_notify (window, xevent);
+        else
+          {
+            GSList *windows;
+            GSList *tmp;
+
+            windows = _wnck_window_get_for_frame (xevent->xconfigure.window);
+
+            for (tmp = windows; tmp != NULL; tmp = tmp->next)
+              _wnck_window_process_frame_configure_notify (tmp->data, xevent);
+
+            g_slist_free (windows);
+          }
+      }
+      break;
+
+    case ReparentNotify:
+      {
+        WnckWindow *window;
+
+        /* Either the window got a new frame, or its frame was reparented */
+        window = wnck_window_get (xevent->xreparent.window);
+
+        if (window)
+          _wnck_window_process_reparent_notify (window, xevent);
+        else
+          {
+            GSList *windows;
+            GSList *tmp;
+
+            windows = _wnck_window_get_for_frame (xevent->xreparent.window);
+
+            for (tmp = windows; tmp != NULL; tmp = tmp->next)
+              _wnck_window_process_reparent_notify (tmp->data, xevent);
+
+            g_slist_free (windows);
+          }
       }
       break;
 
@@ -843,7 +919,7 @@ _wnck_iconify (Screen *screen,
 
   _wnck_error_trap_push (display);
   XIconifyWindow (display, xwindow, DefaultScreen (display));
-  _wnck_error_trap_pop (display);
+  _wnck_error_trap_pop_request (display);
 }
 
 void
@@ -865,7 +941,7 @@ _wnck_deiconify (Screen *screen,
     gdk_window_show (gdkwindow);
   else
     XMapRaised (display, xwindow);
-  _wnck_error_trap_pop (display);
+  _wnck_error_trap_pop_request (display);
 }
 
 void
@@ -899,7 +975,7 @@ _wnck_close (Screen *screen,
               False,
 	      SubstructureRedirectMask | SubstructureNotifyMask,
 	      &xev);
-  _wnck_error_trap_pop (display);
+  _wnck_error_trap_pop_request (display);
 }
 
 #define _NET_WM_MOVERESIZE_SIZE_TOPLEFT      0
@@ -944,7 +1020,7 @@ _wnck_keyboard_move (Screen *screen,
               False,
               SubstructureRedirectMask | SubstructureNotifyMask,
               &xev);
-  _wnck_error_trap_pop (display);
+  _wnck_error_trap_pop_request (display);
 }
 
 void
@@ -977,7 +1053,7 @@ _wnck_keyboard_size (Screen *screen,
               False,
               SubstructureRedirectMask | SubstructureNotifyMask,
               &xev);
-  _wnck_error_trap_pop (display);
+  _wnck_error_trap_pop_request (display);
 }
 
 void
@@ -1017,7 +1093,7 @@ _wnck_change_state (Screen  *screen,
               False,
 	      SubstructureRedirectMask | SubstructureNotifyMask,
 	      &xev);
-  _wnck_error_trap_pop (display);
+  _wnck_error_trap_pop_request (display);
 }
 
 void
@@ -1051,7 +1127,7 @@ _wnck_change_workspace (Screen     *screen,
               False,
 	      SubstructureRedirectMask | SubstructureNotifyMask,
 	      &xev);
-  _wnck_error_trap_pop (display);
+  _wnck_error_trap_pop_request (display);
 }
 
 void
@@ -1089,7 +1165,7 @@ _wnck_activate (Screen *screen,
               False,
 	      SubstructureRedirectMask | SubstructureNotifyMask,
 	      &xev);
-  _wnck_error_trap_pop (display);
+  _wnck_error_trap_pop_request (display);
 }
 
 void
@@ -1123,7 +1199,7 @@ _wnck_activate_workspace (Screen *screen,
               False,
 	      SubstructureRedirectMask | SubstructureNotifyMask,
 	      &xev);
-  _wnck_error_trap_pop (display);
+  _wnck_error_trap_pop_request (display);
 }
 
 void
@@ -1225,22 +1301,108 @@ _wnck_get_pid (Screen *screen,
     return val;
 }
 
+static char*
+read_name_source (Screen         *screen,
+                  Window          xwindow,
+                  gboolean        icon_name,
+                  WnckNameSource  source)
+{
+  switch (source)
+    {
+    case WNCK_NAME_SOURCE_VISIBLE:
+      return _wnck_get_utf8_property (screen, xwindow,
+                                      _wnck_atom_get (icon_name ?
+                                                      "_NET_WM_VISIBLE_ICON_NAME" :
+                                                      "_NET_WM_VISIBLE_NAME"));
+    case WNCK_NAME_SOURCE_NET:
+      return _wnck_get_utf8_property (screen, xwindow,
+                                      _wnck_atom_get (icon_name ?
+                                                      "_NET_WM_ICON_NAME" :
+                                                      "_NET_WM_NAME"));
+    case WNCK_NAME_SOURCE_LEGACY:
+      return _wnck_get_text_property (screen, xwindow,
+                                      icon_name ? XA_WM_ICON_NAME : XA_WM_NAME);
+    case WNCK_NAME_SOURCE_NONE:
+    default:
+      g_assert_not_reached ();
+      return NULL;
+    }
+}
+
+WnckNameSource
+_wnck_name_source_for_atom (Atom atom)
+{
+  if (atom == _wnck_atom_get ("_NET_WM_VISIBLE_NAME") ||
+      atom == _wnck_atom_get ("_NET_WM_VISIBLE_ICON_NAME"))
+    return WNCK_NAME_SOURCE_VISIBLE;
+  else if (atom == _wnck_atom_get ("_NET_WM_NAME") ||
+           atom == _wnck_atom_get ("_NET_WM_ICON_NAME"))
+    return WNCK_NAME_SOURCE_NET;
+  else if (atom == XA_WM_NAME ||
+           atom == XA_WM_ICON_NAME)
+    return WNCK_NAME_SOURCE_LEGACY;
+  else
+    return WNCK_NAME_SOURCE_NONE;
+}
+
+/* Re-reads the name (or icon name) of @xwindow, knowing that it was last
+ * taken from *@source and that only the sources in the @changed mask
+ * (1 << WnckNameSource) have been touched since. Sources of higher
+ * priority than *@source that did not change are known to be unset, and
+ * the ones of lower priority only matter if *@source itself went away, so
+ * usually a single property is fetched.
+ *
+ * Returns FALSE if the name cannot have changed; otherwise *@name is the
+ * new name (possibly NULL) and *@source is updated.
+ */
+gboolean
+_wnck_read_name (Screen         *screen,
+                 Window          xwindow,
+                 gboolean        icon_name,
+                 guint           changed,
+                 WnckNameSource *source,
+                 char          **name)
+{
+  WnckNameSource current;
+  int i;
+
+  *name = NULL;
+  current = *source;
+
+  for (i = WNCK_NAME_SOURCE_VISIBLE; i < WNCK_NAME_SOURCE_NONE; i++)
+    {
+      char *value;
+
+      if (i <= (int) current && !(changed & (1 << i)))
+        {
+          if (i == (int) current)
+            return FALSE;
+          continue;
+        }
+
+      value = read_name_source (screen, xwindow, icon_name, i);
+      if (value != NULL)
+        {
+          *source = i;
+          *name = value;
+          return TRUE;
+        }
+    }
+
+  *source = WNCK_NAME_SOURCE_NONE;
+
+  return TRUE;
+}
+
 char*
 _wnck_get_name (Screen *screen,
                 Window  xwindow)
 {
+  WnckNameSource source = WNCK_NAME_SOURCE_NONE;
   char *name;
 
-  name = _wnck_get_utf8_property (screen, xwindow,
-                                  _wnck_atom_get ("_NET_WM_VISIBLE_NAME"));
-
-  if (name == NULL)
-    name = _wnck_get_utf8_property (screen, xwindow,
-                                    _wnck_atom_get ("_NET_WM_NAME"));
-
-  if (name == NULL)
-    name = _wnck_get_text_property (screen, xwindow,
-                                    XA_WM_NAME);
+  _wnck_read_name (screen, xwindow, FALSE, WNCK_NAME_SOURCE_ALL,
+                   &source, &name);
 
   return name;
 }
@@ -1249,18 +1411,11 @@ char*
 _wnck_get_icon_name (Screen *screen,
                      Window  xwindow)
 {
+  WnckNameSource source = WNCK_NAME_SOURCE_NONE;
   char *name;
 
-  name = _wnck_get_utf8_property (screen, xwindow,
-                                  _wnck_atom_get ("_NET_WM_VISIBLE_ICON_NAME"));
-
-  if (name == NULL)
-    name = _wnck_get_utf8_property (screen, xwindow,
-                                    _wnck_atom_get ("_NET_WM_ICON_NAME"));
-
-  if (name == NULL)
-    name = _wnck_get_text_property (screen, xwindow,
-                                    XA_WM_ICON_NAME);
+  _wnck_read_name (screen, xwindow, TRUE, WNCK_NAME_SOURCE_ALL,
+                   &source, &name);
 
   return name;
 }
@@ -1393,18 +1548,31 @@ _wnck_select_input (Screen *screen,
       /* Avoid breaking GDK's setup,
        * this somewhat relies on people setting
        * event masks right after realization
-       * and not changing them again
+       * and not changing them again; which also means that once we know
+       * the mask of a window, we can remember the masks we select on it
+       * instead of asking the server again
        */
-      XWindowAttributes attrs;
-      XGetWindowAttributes (display, xwindow, &attrs);
-      old_mask = attrs.your_event_mask;
+      old_mask = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (gdkwindow),
+                                                     "wnck-event-mask"));
+
+      if (old_mask == 0)
+        {
+          XWindowAttributes attrs;
+          XGetWindowAttributes (display, xwindow, &attrs);
+          old_mask = attrs.your_event_mask;
+        }
 
       if (update)
-        mask |= attrs.your_event_mask;
+        mask |= old_mask;
+
+      g_object_set_data (G_OBJECT (gdkwindow), "wnck-event-mask",
+                         GINT_TO_POINTER (mask));
     }
 
+  /* foreign windows cost no round-trip: the request is only flushed, in a
+   * request batch when several windows are discovered at once */
   XSelectInput (display, xwindow, mask);
-  _wnck_error_trap_pop (display);
+  _wnck_error_trap_pop_request (display);
 
   return old_mask;
 }
@@ -1658,6 +1826,434 @@ free_pixels (guchar *pixels, gpointer data)
   g_free (pixels);
 }
 
+#ifdef HAVE_XSHM
+/* Pixmaps (legacy icons and the root background) are read through one
+ * shared memory segment, kept attached and grown as needed: reading a
+ * pixmap then costs a single XShmGetImage request, and the pixels are
+ * converted straight from the segment.
+ */
+static Display         *shm_display = NULL;
+static XShmSegmentInfo  shm_info;
+static gsize            shm_size = 0;
+static gboolean         shm_unavailable = FALSE;
+
+static void
+shm_segment_free (void)
+{
+  if (shm_size == 0)
+    return;
+
+  XShmDetach (shm_display, &shm_info);
+  shmdt (shm_info.shmaddr);
+
+  shm_info.shmaddr = NULL;
+  shm_size = 0;
+}
+
+static gboolean
+shm_segment_ensure (Display *display,
+                    gsize    size)
+{
+  int err;
+
+  if (display != shm_display)
+    {
+      shm_segment_free ();
+      shm_display = display;
+      shm_unavailable = !XShmQueryExtension (display);
+    }
+
+  if (shm_unavailable)
+    return FALSE;
+
+  if (size <= shm_size)
+    return TRUE;
+
+  shm_segment_free ();
+
+  /* a root background usually follows, so don't grow by small steps */
+  size = MAX (size, 64 * 1024);
+
+  /* Allocation failures are usually about this size only (e.g. a large
+   * root background above SHMMAX): only this read falls back to XGetImage,
+   * smaller pixmaps can still use a segment later.
+   */
+  shm_info.shmid = shmget (IPC_PRIVATE, size, IPC_CREAT | 0600);
+  if (shm_info.shmid < 0)
+    return FALSE;
+
+  shm_info.shmaddr = shmat (shm_info.shmid, NULL, 0);
+  if (shm_info.shmaddr == (char *) -1)
+    {
+      shmctl (shm_info.shmid, IPC_RMID, NULL);
+      shm_info.shmaddr = NULL;
+      return FALSE;
+    }
+
+  shm_info.readOnly = False;
+
+  _wnck_error_trap_push (display);
+  XShmAttach (display, &shm_info);
+  err = _wnck_error_trap_pop (display);
+
+  /* The segment will go away as soon as both sides have detached */
+  shmctl (shm_info.shmid, IPC_RMID, NULL);
+
+  if (err != Success)
+    {
+      /* e.g. a remote display */
+      shmdt (shm_info.shmaddr);
+      shm_info.shmaddr = NULL;
+      shm_unavailable = TRUE;
+      return FALSE;
+    }
+
+  shm_size = size;
+
+  return TRUE;
+}
+
+/* Returns the content of xpixmap as an XImage living in the shared memory
+ * segment, or NULL if MIT-SHM cannot be used. The image is only valid
+ * until the next call, and must be freed with shm_image_destroy().
+ */
+static XImage *
+shm_get_pixmap_image (Screen *screen,
+                      Pixmap  xpixmap,
+                      int     width,
+                      int     height,
+                      int     depth)
+{
+  Display *display;
+  XImage *image;
+  Bool ok;
+
+  display = DisplayOfScreen (screen);
+
+  if (display == shm_display && shm_unavailable)
+    return NULL;
+
+  image = XShmCreateImage (display, DefaultVisualOfScreen (screen), depth,
+                           ZPixmap, NULL, &shm_info, width, height);
+  if (image == NULL)
+    return NULL;
+
+  if (!shm_segment_ensure (display, image->bytes_per_line * image->height))
+    {
+      XDestroyImage (image);
+      return NULL;
+    }
+
+  image->data = shm_info.shmaddr;
+
+  _wnck_error_trap_push (display);
+  ok = XShmGetImage (display, xpixmap, image, 0, 0, AllPlanes);
+  if (_wnck_error_trap_pop (display) != Success)
+    ok = False;
+
+  if (!ok)
+    {
+      image->data = NULL;
+      XDestroyImage (image);
+      return NULL;
+    }
+
+  return image;
+}
+
+static void
+shm_image_destroy (XImage *image)
+{
+  /* the data belongs to the segment */
+  image->data = NULL;
+  XDestroyImage (image);
+}
+
+static void
+mask_to_shift (unsigned long  mask,
+               int           *shift,
+               int           *bits)
+{
+  *shift = 0;
+  *bits = 0;
+
+  if (mask == 0)
+    return;
+
+  while (!(mask & 1))
+    {
+      mask >>= 1;
+      (*shift)++;
+    }
+
+  while (mask & 1)
+    {
+      mask >>= 1;
+      (*bits)++;
+    }
+}
+
+static guint32
+scale_channel (unsigned long pixel,
+               unsigned long mask,
+               int           shift,
+               int           bits)
+{
+  guint32 value;
+
+  value = (pixel & mask) >> shift;
+
+  if (bits >= 8)
+    return value >> (bits - 8);
+  else if (bits > 0)
+    return value * 255 / ((1 << bits) - 1);
+  else
+    return 0;
+}
+
+static gboolean
+image_get_bit (XImage *image,
+               int     x,
+               int     y)
+{
+  guchar byte;
+
+  /* When both orders agree, bit x lives in byte x / 8 whatever the unit */
+  if (image->byte_order != image->bitmap_bit_order)
+    return XGetPixel (image, x, y) != 0;
+
+  byte = ((guchar *) image->data)[y * image->bytes_per_line + x / 8];
+
+  if (image->bitmap_bit_order == LSBFirst)
+    return (byte >> (x & 7)) & 1;
+  else
+    return (byte >> (7 - (x & 7))) & 1;
+}
+
+/* Converts row y of image to 0x00RRGGBB pixels. Bitmaps are white on
+ * black, like cairo renders them for us in the slow path.
+ */
+static void
+image_get_rgb_row (XImage  *image,
+                   Visual  *visual,
+                   int      y,
+                   guint32 *dest)
+{
+  int x;
+
+  if (image->depth == 1)
+    {
+      for (x = 0; x < image->width; x++)
+        dest[x] = image_get_bit (image, x, y) ? 0xffffff : 0;
+    }
+  else if (image->bits_per_pixel == 32 &&
+           image->byte_order == (G_BYTE_ORDER == G_LITTLE_ENDIAN ? LSBFirst
+                                                                 : MSBFirst) &&
+           visual->red_mask == 0xff0000 &&
+           visual->green_mask == 0x00ff00 &&
+           visual->blue_mask == 0x0000ff)
+    {
+      /* the common 24/32 bit TrueColor case */
+      const guint32 *src;
+
+      src = (const guint32 *) (image->data + y * image->bytes_per_line);
+
+      for (x = 0; x < image->width; x++)
+        dest[x] = src[x] & 0xffffff;
+    }
+  else
+    {
+      int r_shift, r_bits, g_shift, g_bits, b_shift, b_bits;
+
+      mask_to_shift (visual->red_mask, &r_shift, &r_bits);
+      mask_to_shift (visual->green_mask, &g_shift, &g_bits);
+      mask_to_shift (visual->blue_mask, &b_shift, &b_bits);
+
+      for (x = 0; x < image->width; x++)
+        {
+          unsigned long pixel = XGetPixel (image, x, y);
+
+          dest[x] =
+            scale_channel (pixel, visual->red_mask, r_shift, r_bits) << 16 |
+            scale_channel (pixel, visual->green_mask, g_shift, g_bits) << 8 |
+            scale_channel (pixel, visual->blue_mask, b_shift, b_bits);
+        }
+    }
+}
+
+static gboolean
+shm_get_pixmap_geometry (Screen *screen,
+                         Pixmap  xpixmap,
+                         int    *width,
+                         int    *height,
+                         int    *depth)
+{
+  Display *display;
+  Window root_return;
+  int x_ret, y_ret;
+  unsigned int w_ret, h_ret, bw_ret, depth_ret;
+  Status status;
+
+  display = DisplayOfScreen (screen);
+
+  _wnck_error_trap_push (display);
+  status = XGetGeometry (display, xpixmap, &root_return,
+                         &x_ret, &y_ret, &w_ret, &h_ret, &bw_ret, &depth_ret);
+  if (_wnck_error_trap_pop (display) != Success || !status)
+    return FALSE;
+
+  /* Without a visual, pixmaps of other depths are ambiguous: leave them to
+   * the slow path, like we do for non TrueColor visuals.
+   */
+  if (depth_ret != 1 &&
+      (depth_ret != (unsigned int) DefaultDepthOfScreen (screen) ||
+       DefaultVisualOfScreen (screen)->class != TrueColor))
+    return FALSE;
+
+  *width = w_ret;
+  *height = h_ret;
+  *depth = depth_ret;
+
+  return TRUE;
+}
+
+static cairo_surface_t *
+shm_image_surface_get_from_pixmap (Screen *screen,
+                                   Pixmap  xpixmap)
+{
+  cairo_surface_t *surface;
+  XImage *image;
+  guchar *data;
+  int stride;
+  int width, height, depth;
+  int y;
+
+  if (!shm_get_pixmap_geometry (screen, xpixmap, &width, &height, &depth))
+    return NULL;
+
+  image = shm_get_pixmap_image (screen, xpixmap, width, height, depth);
+  if (image == NULL)
+    return NULL;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, width, height);
+  if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+    {
+      shm_image_destroy (image);
+      cairo_surface_destroy (surface);
+      return NULL;
+    }
+
+  cairo_surface_flush (surface);
+
+  data = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
+
+  for (y = 0; y < height; y++)
+    image_get_rgb_row (image, DefaultVisualOfScreen (screen), y,
+                       (guint32 *) (data + y * stride));
+
+  shm_image_destroy (image);
+
+  cairo_surface_mark_dirty (surface);
+
+  return surface;
+}
+
+static GdkPixbuf *
+shm_pixbuf_get_from_pixmap_and_mask (Screen *screen,
+                                     Pixmap  src_pixmap,
+                                     Pixmap  src_mask)
+{
+  GdkPixbuf *pixbuf;
+  XImage *image;
+  guint32 *row;
+  guchar *pixels;
+  int rowstride;
+  int width, height, depth;
+  int x, y;
+
+  if (!shm_get_pixmap_geometry (screen, src_pixmap, &width, &height, &depth))
+    return NULL;
+
+  image = shm_get_pixmap_image (screen, src_pixmap, width, height, depth);
+  if (image == NULL)
+    return NULL;
+
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, width, height);
+  pixels = gdk_pixbuf_get_pixels (pixbuf);
+  rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+
+  row = g_new (guint32, width);
+
+  for (y = 0; y < height; y++)
+    {
+      guchar *p = pixels + y * rowstride;
+
+      image_get_rgb_row (image, DefaultVisualOfScreen (screen), y, row);
+
+      for (x = 0; x < width; x++)
+        {
+          p[0] = row[x] >> 16;
+          p[1] = row[x] >> 8;
+          p[2] = row[x];
+          /* opaque unless there is a mask */
+          p[3] = src_mask == None ? 0xff : 0;
+          p += 4;
+        }
+    }
+
+  g_free (row);
+
+  /* the mask reuses the segment */
+  shm_image_destroy (image);
+
+  if (src_mask != None)
+    {
+      int mask_width, mask_height, mask_depth;
+
+      image = NULL;
+      if (shm_get_pixmap_geometry (screen, src_mask,
+                                   &mask_width, &mask_height, &mask_depth) &&
+          mask_depth == 1)
+        image = shm_get_pixmap_image (screen, src_mask,
+                                      mask_width, mask_height, 1);
+
+      if (image == NULL)
+        {
+          g_object_unref (pixbuf);
+          return NULL;
+        }
+
+      /* Pixels outside of the mask are transparent */
+      for (y = 0; y < MIN (height, mask_height); y++)
+        {
+          guchar *p = pixels + y * rowstride + 3;
+
+          for (x = 0; x < MIN (width, mask_width); x++)
+            {
+              if (image_get_bit (image, x, y))
+                *p = 0xff;
+              p += 4;
+            }
+        }
+
+      shm_image_destroy (image);
+    }
+
+  return pixbuf;
+}
+#endif /* HAVE_XSHM */
+
+void
+_wnck_pixmap_shm_shutdown (void)
+{
+#ifdef HAVE_XSHM
+  shm_segment_free ();
+  shm_display = NULL;
+  shm_unavailable = FALSE;
+#endif
+}
+
 static cairo_surface_t *
 _wnck_cairo_surface_get_from_pixmap (Screen *screen,
                                      Pixmap  xpixmap)
@@ -1703,26 +2299,49 @@ TRAP_POP:
   return surface;
 }
 
-GdkPixbuf*
-_wnck_gdk_pixbuf_get_from_pixmap (Screen *screen,
-                                  Pixmap  xpixmap)
+/* Copies the content of xpixmap to client memory, so that it can be
+ * processed without the X connection (in another thread, for example).
+ */
+cairo_surface_t*
+_wnck_cairo_image_surface_get_from_pixmap (Screen *screen,
+                                           Pixmap  xpixmap)
 {
   cairo_surface_t *surface;
-  GdkPixbuf *retval;
+  cairo_surface_t *image;
+  cairo_t *cr;
+
+#ifdef HAVE_XSHM
+  image = shm_image_surface_get_from_pixmap (screen, xpixmap);
+  if (image != NULL)
+    return image;
+#endif
 
   surface = _wnck_cairo_surface_get_from_pixmap (screen, xpixmap);
 
   if (surface == NULL)
     return NULL;
 
-  retval = gdk_pixbuf_get_from_surface (surface,
-                                        0,
-                                        0,
-                                        cairo_xlib_surface_get_width (surface),
-                                        cairo_xlib_surface_get_height (surface));
+  image = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
+                                      cairo_xlib_surface_get_width (surface),
+                                      cairo_xlib_surface_get_height (surface));
+
+  cr = cairo_create (image);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface (cr, surface, 0, 0);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
   cairo_surface_destroy (surface);
 
-  return retval;
+  if (cairo_surface_status (image) != CAIRO_STATUS_SUCCESS)
+    {
+      cairo_surface_destroy (image);
+      return NULL;
+    }
+
+  cairo_surface_flush (image);
+
+  return image;
 }
 
 static gboolean
@@ -1744,6 +2363,12 @@ try_pixmap_and_mask (Screen     *screen,
   if (src_pixmap == None)
     return FALSE;
 
+#ifdef HAVE_XSHM
+  unscaled = shm_pixbuf_get_from_pixmap_and_mask (screen, src_pixmap, src_mask);
+  if (unscaled != NULL)
+    goto SCALE;
+#endif
+
   surface = _wnck_cairo_surface_get_from_pixmap (screen, src_pixmap);
 
   if (surface && src_mask != None)
@@ -1798,6 +2423,9 @@ try_pixmap_and_mask (Screen     *screen,
 
   cairo_surface_destroy (image);
 
+#ifdef HAVE_XSHM
+SCALE:
+#endif
   if (unscaled)
     {
       *iconp =
@@ -2257,39 +2885,98 @@ _wnck_read_icons (Screen        *screen,
   return FALSE;
 }
 
+/* The fallback icon is the same for every window lacking an icon, so it
+ * is decoded once, and each size is scaled once and then shared by all
+ * windows, applications and class groups needing it.
+ */
+static GdkPixbuf  *default_icon = NULL;
+static GHashTable *default_icons_by_size = NULL;
+
 static GdkPixbuf*
 default_icon_at_size (int width,
                       int height)
 {
+  GdkPixbuf *scaled;
+  gpointer   key;
 
-  GdkPixbuf *base;
-
-  base = gdk_pixbuf_new_from_inline (-1, default_icon_data,
-                                     FALSE,
-                                     NULL);
+  if (default_icon == NULL)
+    {
+      default_icon = gdk_pixbuf_new_from_inline (-1, default_icon_data,
+                                                 FALSE,
+                                                 NULL);
 
-  g_assert (base);
+      g_assert (default_icon);
+    }
 
   if ((width < 0 && height < 0) ||
-      (gdk_pixbuf_get_width (base) == width &&
-       gdk_pixbuf_get_height (base) == height))
+      (gdk_pixbuf_get_width (default_icon) == width &&
+       gdk_pixbuf_get_height (default_icon) == height))
     {
-      return base;
+      return g_object_ref (default_icon);
     }
-  else
-    {
-      GdkPixbuf *scaled;
 
-      scaled = gdk_pixbuf_scale_simple (base,
-                                        width > 0 ? width :
-                                        gdk_pixbuf_get_width (base),
-                                        height > 0 ? height :
-                                        gdk_pixbuf_get_height (base),
+  if (width <= 0)
+    width = gdk_pixbuf_get_width (default_icon);
+  if (height <= 0)
+    height = gdk_pixbuf_get_height (default_icon);
+
+  if (default_icons_by_size == NULL)
+    default_icons_by_size = g_hash_table_new_full (NULL, NULL, NULL,
+                                                   g_object_unref);
+
+  key = GUINT_TO_POINTER (((guint) width << 16) | ((guint) height & 0xffff));
+
+  scaled = g_hash_table_lookup (default_icons_by_size, key);
+  if (scaled == NULL)
+    {
+      scaled = gdk_pixbuf_scale_simple (default_icon, width, height,
                                         GDK_INTERP_BILINEAR);
+      g_hash_table_insert (default_icons_by_size, key, scaled);
+    }
+
+  return g_object_ref (scaled);
+}
+
+void
+_wnck_fallback_icons_shutdown (void)
+{
+  if (default_icons_by_size != NULL)
+    {
+      g_hash_table_destroy (default_icons_by_size);
+      default_icons_by_size = NULL;
+    }
+
+  if (default_icon != NULL)
+    {
+      g_object_unref (default_icon);
+      default_icon = NULL;
+    }
+}
+
+static void
+default_icons_add_memory_usage (gpointer key,
+                                gpointer value,
+                                gpointer data)
+{
+  gpointer *args = data;
+
+  _wnck_memory_usage_add_pixbuf (args[0], args[1], value);
+}
 
-      g_object_unref (G_OBJECT (base));
+void
+_wnck_fallback_icons_add_memory_usage (WnckMemoryUsage *usage,
+                                       GHashTable      *pixbufs)
+{
+  gpointer args[2];
 
-      return scaled;
+  _wnck_memory_usage_add_pixbuf (usage, pixbufs, default_icon);
+
+  if (default_icons_by_size != NULL)
+    {
+      args[0] = usage;
+      args[1] = pixbufs;
+      g_hash_table_foreach (default_icons_by_size,
+                            default_icons_add_memory_usage, args);
     }
 }
 
@@ -2314,36 +3001,412 @@ _wnck_get_fallback_icons (GdkPixbuf **iconp,
                                         DEFAULT_MINI_ICON_HEIGHT);
 }
 
+/* Scaled and dimmed variants of an icon, as shown by the tasklist and the
+ * selector, are kept with the source pixbuf: they are computed once per
+ * (size, dimmed) pair and go away with the source icon.
+ */
+typedef struct
+{
+  int        width;
+  int        height;
+  gboolean   dimmed;
+  GdkPixbuf *pixbuf;
+} WnckIconVariant;
+
+static GQuark icon_variants_quark = 0;
+
+static void
+free_icon_variants (gpointer data)
+{
+  GSList *l;
 
+  for (l = data; l != NULL; l = l->next)
+    {
+      WnckIconVariant *variant = l->data;
+
+      g_object_unref (variant->pixbuf);
+      g_slice_free (WnckIconVariant, variant);
+    }
+
+  g_slist_free (data);
+}
+
+/* Counts the variants kept with @source, see _wnck_icon_get_variant() */
 void
-_wnck_get_window_geometry (Screen *screen,
-			   Window  xwindow,
-                           int    *xp,
-                           int    *yp,
-                           int    *widthp,
-                           int    *heightp)
+_wnck_icon_variants_add_memory_usage (WnckMemoryUsage *usage,
+                                      GHashTable      *pixbufs,
+                                      GdkPixbuf       *source)
+{
+  GSList *l;
+
+  if (icon_variants_quark == 0)
+    return;
+
+  for (l = g_object_get_qdata (G_OBJECT (source), icon_variants_quark);
+       l != NULL;
+       l = l->next)
+    {
+      WnckIconVariant *variant = l->data;
+
+      _wnck_memory_usage_add_pixbuf (usage, pixbufs, variant->pixbuf);
+    }
+}
+
+/* Downscales src by the same integer factor in both directions, averaging
+ * each factor x factor block with alpha weighting.
+ */
+static GdkPixbuf *
+box_downscale_icon (GdkPixbuf *src,
+                    int        factor)
+{
+  GdkPixbuf *dest;
+  const guchar *src_pixels;
+  guchar *dest_pixels;
+  int src_stride, dest_stride, src_channels;
+  gboolean src_has_alpha;
+  int width, height;
+  int x, y, i, j;
+  guint n;
+
+  width = gdk_pixbuf_get_width (src) / factor;
+  height = gdk_pixbuf_get_height (src) / factor;
+
+  dest = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, width, height);
+
+  src_pixels = gdk_pixbuf_get_pixels (src);
+  src_stride = gdk_pixbuf_get_rowstride (src);
+  src_channels = gdk_pixbuf_get_n_channels (src);
+  src_has_alpha = gdk_pixbuf_get_has_alpha (src);
+
+  dest_pixels = gdk_pixbuf_get_pixels (dest);
+  dest_stride = gdk_pixbuf_get_rowstride (dest);
+
+  n = factor * factor;
+
+  for (y = 0; y < height; y++)
+    {
+      guchar *d = dest_pixels + y * dest_stride;
+
+      for (x = 0; x < width; x++)
+        {
+          guint r, g, b, a;
+
+          r = g = b = a = 0;
+
+          for (j = 0; j < factor; j++)
+            {
+              const guchar *p = src_pixels + (y * factor + j) * src_stride
+                                           + x * factor * src_channels;
+
+              for (i = 0; i < factor; i++)
+                {
+                  guint alpha = src_has_alpha ? p[3] : 255;
+
+                  r += p[0] * alpha;
+                  g += p[1] * alpha;
+                  b += p[2] * alpha;
+                  a += alpha;
+
+                  p += src_channels;
+                }
+            }
+
+          if (a == 0)
+            {
+              d[0] = d[1] = d[2] = d[3] = 0;
+            }
+          else
+            {
+              d[0] = r / a;
+              d[1] = g / a;
+              d[2] = b / a;
+              d[3] = a / n;
+            }
+
+          d += 4;
+        }
+    }
+
+  return dest;
+}
+
+static GdkPixbuf *
+scale_icon (GdkPixbuf *src,
+            int        width,
+            int        height)
+{
+  GdkPixbuf *dest;
+  int src_width, src_height;
+
+  src_width = gdk_pixbuf_get_width (src);
+  src_height = gdk_pixbuf_get_height (src);
+
+  /* Icons usually come in power-of-two sizes, so this is the common case */
+  if (width < src_width &&
+      src_width % width == 0 &&
+      src_height % height == 0 &&
+      src_width / width == src_height / height)
+    return box_downscale_icon (src, src_width / width);
+
+  dest = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, width, height);
+  gdk_pixbuf_scale (src, dest,
+                    0, 0, width, height,
+                    0, 0,
+                    width / (double) src_width,
+                    height / (double) src_height,
+                    GDK_INTERP_HYPER);
+
+  return dest;
+}
+
+static void
+dimm_icon (GdkPixbuf *pixbuf)
+{
+  int x, y, row_stride;
+  guchar *row, *pixels;
+  int w, h;
+
+  g_assert (gdk_pixbuf_get_has_alpha (pixbuf));
+
+  w = gdk_pixbuf_get_width (pixbuf);
+  h = gdk_pixbuf_get_height (pixbuf);
+
+  row = gdk_pixbuf_get_pixels (pixbuf);
+  row_stride = gdk_pixbuf_get_rowstride (pixbuf);
+
+  for (y = 0; y < h; y++)
+    {
+      pixels = row;
+
+      for (x = 0; x < w; x++)
+        {
+          pixels[3] /= 2;
+          pixels += 4;
+        }
+
+      row += row_stride;
+    }
+}
+
+/* Returns a new reference to source scaled to width x height, with its
+ * opacity halved if dimmed is TRUE. The result is cached on source, so
+ * asking again for the same variant (e.g. when a window is minimized and
+ * unminimized) does not compute anything.
+ */
+GdkPixbuf *
+_wnck_icon_get_variant (GdkPixbuf *source,
+                        int        width,
+                        int        height,
+                        gboolean   dimmed)
+{
+  WnckIconVariant *variant;
+  GdkPixbuf *pixbuf;
+  GSList *variants;
+  GSList *l;
+
+  g_return_val_if_fail (GDK_IS_PIXBUF (source), NULL);
+
+  width = MAX (width, 1);
+  height = MAX (height, 1);
+
+  if (!dimmed &&
+      gdk_pixbuf_get_width (source) == width &&
+      gdk_pixbuf_get_height (source) == height)
+    return g_object_ref (source);
+
+  if (icon_variants_quark == 0)
+    icon_variants_quark = g_quark_from_static_string ("wnck-icon-variants");
+
+  variants = g_object_get_qdata (G_OBJECT (source), icon_variants_quark);
+  for (l = variants; l != NULL; l = l->next)
+    {
+      variant = l->data;
+
+      if (variant->width == width &&
+          variant->height == height &&
+          variant->dimmed == dimmed)
+        return g_object_ref (variant->pixbuf);
+    }
+
+  if (dimmed)
+    {
+      GdkPixbuf *undimmed;
+
+      undimmed = _wnck_icon_get_variant (source, width, height, FALSE);
+      if (gdk_pixbuf_get_has_alpha (undimmed))
+        pixbuf = gdk_pixbuf_copy (undimmed);
+      else
+        pixbuf = gdk_pixbuf_add_alpha (undimmed, FALSE, 0, 0, 0);
+      g_object_unref (undimmed);
+
+      dimm_icon (pixbuf);
+
+      /* the recursive call may have added a variant */
+      variants = g_object_get_qdata (G_OBJECT (source), icon_variants_quark);
+    }
+  else
+    pixbuf = scale_icon (source, width, height);
+
+  variant = g_slice_new (WnckIconVariant);
+  variant->width = width;
+  variant->height = height;
+  variant->dimmed = dimmed;
+  variant->pixbuf = pixbuf;
+
+  g_object_steal_qdata (G_OBJECT (source), icon_variants_quark);
+  g_object_set_qdata_full (G_OBJECT (source), icon_variants_quark,
+                           g_slist_prepend (variants, variant),
+                           free_icon_variants);
+
+  return g_object_ref (pixbuf);
+}
+
+
+/* Reads the geometry of xwindow and where it lives in the window tree, so
+ * that the root-relative position of xwindow can later be derived from
+ * ConfigureNotify events on xwindow and on its parent (usually the frame
+ * of the window manager) without asking the X server again.
+ *
+ * parent_event_mask is selected on the new parent, and the event mask on
+ * old_parent (if not None) is cleared: this is all done with only one sync.
+ * *parentp is set to None if the parent of xwindow is the root window. The
+ * position of xwindow is relative to its parent, and does not include the
+ * border. The positions of the parent and of its own parent are
+ * root-relative. *parent_is_toplevelp is set to FALSE if the parent is not
+ * a child of the root window: the positions can then change without any
+ * event on xwindow or on its parent.
+ */
+void
+_wnck_get_window_tree_geometry (Screen *screen,
+                                Window  xwindow,
+                                Window  old_parent,
+                                long    parent_event_mask,
+                                Window *parentp,
+                                int    *xp,
+                                int    *yp,
+                                int    *parent_xp,
+                                int    *parent_yp,
+                                int    *grandparent_xp,
+                                int    *grandparent_yp,
+                                gboolean *parent_is_toplevelp,
+                                int    *widthp,
+                                int    *heightp)
 {
   Display *display;
+  Window   root;
+  Window   root_return;
+  Window   parent;
+  Window  *children;
+  unsigned int n_children;
   int x, y;
   unsigned int width, height, bw, depth;
-  Window root_window;
-
-  width = 1;
-  height = 1;
+  int parent_x, parent_y;
+  unsigned int parent_width, parent_height, parent_bw;
+  Window grandparent;
+  int root_x, root_y;
+  Window child;
 
   display = DisplayOfScreen (screen);
+  root = RootWindowOfScreen (screen);
+
+  parent = None;
+  children = NULL;
+  x = y = 0;
+  width = height = 1;
+  bw = 0;
+  parent_x = parent_y = 0;
+  parent_bw = 0;
+  grandparent = None;
+  root_x = root_y = 0;
 
   _wnck_error_trap_push (display);
 
-  XGetGeometry (display,
-                xwindow,
-                &root_window,
-                &x, &y, &width, &height, &bw, &depth);
+  if (old_parent != None)
+    XSelectInput (display, old_parent, NoEventMask);
+
+  if (!XQueryTree (display, xwindow,
+                   &root_return, &parent, &children, &n_children))
+    parent = None;
+
+  if (children)
+    XFree (children);
+
+  if (!XGetGeometry (display, xwindow,
+                     &root_return, &x, &y, &width, &height, &bw, &depth))
+    bw = 0;
+
+  if (parent == root)
+    parent = None;
+
+  if (parent != None)
+    {
+      /* The parent is not at (0, 0): we need its position, and its
+       * position in its own parent, so that later ConfigureNotify events
+       * on the parent can be made root-relative. We only need to ask for
+       * them once.
+       */
+      XTranslateCoordinates (display, parent, root,
+                             0, 0, &root_x, &root_y, &child);
+
+      if (!XGetGeometry (display, parent,
+                         &root_return, &parent_x, &parent_y,
+                         &parent_width, &parent_height, &parent_bw, &depth))
+        {
+          parent_x = parent_y = 0;
+          parent_bw = 0;
+        }
+
+      /* Some window managers nest the frame in other windows, whose moves
+       * don't generate any event on the frame */
+      if (XQueryTree (display, parent,
+                      &root_return, &grandparent, &children, &n_children))
+        {
+          if (children)
+            XFree (children);
+        }
+      else
+        grandparent = None;
+
+      if (parent_event_mask != NoEventMask)
+        XSelectInput (display, parent, parent_event_mask);
+    }
 
   _wnck_error_trap_pop (display);
 
-  _wnck_get_window_position (screen, xwindow, xp, yp);
+  if (parentp)
+    *parentp = parent;
+
+  if (parent != None)
+    {
+      if (parent_xp)
+        *parent_xp = root_x;
+      if (parent_yp)
+        *parent_yp = root_y;
+      if (grandparent_xp)
+        *grandparent_xp = root_x - (parent_x + (int) parent_bw);
+      if (grandparent_yp)
+        *grandparent_yp = root_y - (parent_y + (int) parent_bw);
+      if (parent_is_toplevelp)
+        *parent_is_toplevelp = (grandparent == root);
+    }
+  else
+    {
+      if (parent_xp)
+        *parent_xp = 0;
+      if (parent_yp)
+        *parent_yp = 0;
+      if (grandparent_xp)
+        *grandparent_xp = 0;
+      if (grandparent_yp)
+        *grandparent_yp = 0;
+      if (parent_is_toplevelp)
+        *parent_is_toplevelp = TRUE;
+    }
 
+  if (xp)
+    *xp = x + bw;
+  if (yp)
+    *yp = y + bw;
   if (widthp)
     *widthp = width;
   if (heightp)
@@ -2384,7 +3447,7 @@ void _wnck_set_window_geometry (Screen *screen,
               False,
               SubstructureRedirectMask | SubstructureNotifyMask,
               &xev);
-  _wnck_error_trap_pop (display);
+  _wnck_error_trap_pop_request (display);
 }
 
 void
@@ -2444,7 +3507,7 @@ _wnck_set_icon_geometry  (Screen *screen,
 		   XA_CARDINAL, 32, PropModeReplace,
 		   (guchar *)&data, 4);
 
-  _wnck_error_trap_pop (display);
+  _wnck_error_trap_pop_request (display);
 }
 
 GdkDisplay*
@@ -89,6 +89,10 @@ void     _wnck_set_utf8_list     (Screen  *screen,
 void _wnck_error_trap_push (Display *display);
 int  _wnck_error_trap_pop  (Display *display);
 
+void _wnck_error_trap_pop_request (Display *display);
+void _wnck_begin_request_batch    (void);
+void _wnck_end_request_batch      (Display *display);
+
 #define _wnck_atom_get(atom_name) gdk_x11_get_xatom_by_name (atom_name)
 #define _wnck_atom_name(atom)     gdk_x11_get_xatom_name (atom)
 
@@ -134,6 +138,25 @@ char*  _wnck_get_name           (Screen *screen,
                                  Window  xwindow);
 char*  _wnck_get_icon_name      (Screen *screen,
                                  Window  xwindow);
+
+/* Where a window name comes from, by decreasing priority */
+typedef enum
+{
+  WNCK_NAME_SOURCE_VISIBLE, /* _NET_WM_VISIBLE_NAME, _NET_WM_VISIBLE_ICON_NAME */
+  WNCK_NAME_SOURCE_NET,     /* _NET_WM_NAME, _NET_WM_ICON_NAME */
+  WNCK_NAME_SOURCE_LEGACY,  /* WM_NAME, WM_ICON_NAME */
+  WNCK_NAME_SOURCE_NONE
+} WnckNameSource;
+
+#define WNCK_NAME_SOURCE_ALL ((1 << WNCK_NAME_SOURCE_NONE) - 1)
+
+WnckNameSource _wnck_name_source_for_atom (Atom atom);
+gboolean       _wnck_read_name            (Screen         *screen,
+                                           Window          xwindow,
+                                           gboolean        icon_name,
+                                           guint           changed,
+                                           WnckNameSource *source,
+                                           char          **name);
 char*  _wnck_get_res_class_utf8 (Screen *screen,
                                  Window  xwindow);
 void   _wnck_get_wmclass        (Screen *screen,
@@ -187,15 +210,29 @@ void _wnck_get_fallback_icons (GdkPixbuf     **iconp,
                                GdkPixbuf     **mini_iconp,
                                int             ideal_mini_width,
                                int             ideal_mini_height);
-
-
-
-void _wnck_get_window_geometry (Screen *screen,
-				Window  xwindow,
-                                int    *xp,
-                                int    *yp,
-                                int    *widthp,
-                                int    *heightp);
+void _wnck_fallback_icons_shutdown (void);
+
+GdkPixbuf* _wnck_icon_get_variant (GdkPixbuf *source,
+                                   int        width,
+                                   int        height,
+                                   gboolean   dimmed);
+
+
+
+void _wnck_get_window_tree_geometry (Screen *screen,
+                                     Window  xwindow,
+                                     Window  old_parent,
+                                     long    parent_event_mask,
+                                     Window *parentp,
+                                     int    *xp,
+                                     int    *yp,
+                                     int    *parent_xp,
+                                     int    *parent_yp,
+                                     int    *grandparent_xp,
+                                     int    *grandparent_yp,
+                                     gboolean *parent_is_toplevelp,
+                                     int    *widthp,
+                                     int    *heightp);
 void _wnck_set_window_geometry (Screen *screen,
                                 Window  xwindow,
                                 int     gravity_and_flags,
@@ -220,8 +257,9 @@ void _wnck_set_desktop_layout (Screen *xscreen,
                                int     rows,
                                int     columns);
 
-GdkPixbuf* _wnck_gdk_pixbuf_get_from_pixmap (Screen *screen,
-                                             Pixmap  xpixmap);
+void             _wnck_pixmap_shm_shutdown (void);
+cairo_surface_t* _wnck_cairo_image_surface_get_from_pixmap (Screen *screen,
+                                                            Pixmap  xpixmap);
 
 GdkDisplay* _wnck_gdk_display_lookup_from_display (Display *display);
 